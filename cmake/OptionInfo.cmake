@@ -9,4 +9,17 @@ function(printOptionInfo option name flag)
     else()
         message("  WITHOUT ${name} (${option} = OFF)")
     endif()
-endfunction()
\ No newline at end of file
+endfunction()
+# Like printOptionInfo but does not pass any flag to add_definitions.
+# Use this for options that change public headers. Their flags have to be added to the polypropylene target
+# with target_compile_definitions(polypropylene PUBLIC ...), such that targets linking against it see them, too.
+# Takes:
+# option - A CMake option
+# name - A custom name for that option that describes that option
+function(printPublicOptionInfo option name)
+    if (${option})
+        message("  WITH ${name} (${option} = ON)")
+    else()
+        message("  WITHOUT ${name} (${option} = OFF)")
+    endif()
+endfunction()
@@ -22,4 +22,9 @@ namespace PAX::Examples {
     void Cheese::detached(class Pizza & pizza) {
         pizza.getEventService().remove<BakedEvent, Cheese, &Cheese::baked>(this);
     }
+
+    void Cheese::relocated(class Pizza & pizza, Property * oldLocation) {
+        pizza.getEventService().remove<BakedEvent, Cheese, &Cheese::baked>(static_cast<Cheese*>(oldLocation));
+        pizza.getEventService().add<BakedEvent, Cheese, &Cheese::baked>(this);
+    }
 }
@@ -22,6 +22,7 @@ namespace PAX::Examples {
 
         void attached(Pizza & pizza) override;
         void detached(Pizza & pizza) override;
+        void relocated(Pizza & pizza, Property * oldLocation) override;
 
         void baked(BakedEvent & e);
     };
@@ -5,15 +5,29 @@
 #ifndef POLYPROPYLENE_EVENTSERVICE_H
 #define POLYPROPYLENE_EVENTSERVICE_H
 
+#include <vector>
 #include "Delegate.h"
-#include <polypropylene/reflection/TypeMap.h>
+#include <polypropylene/reflection/TypeIndex.h>
 #include <polypropylene/stdutils/CollectionUtils.h>
 
 namespace PAX {
     class EventService {
     protected:
+        /**
+         * The listeners of a single event class.
+         */
+        struct ListenerList {
+            /// The TypeIndex of the event class.
+            TypeIndex event;
+            /// The std::vector<Delegate<EventClass&>> holding the listeners.
+            void * delegates;
+            /// Deletes delegates with its actual type.
+            void (*deleteDelegates)(void*);
+        };
+
         EventService *_parent = nullptr;
-        TypeMap<void*> _listeners;
+        /// Sorted by the TypeIndex of the event classes, such that listeners are found by a binary search over integers.
+        std::vector<ListenerList> _listeners;
 
         template<typename EventClass, class T, void (T::*Method)(EventClass&)>
         static void invoke(void* callee, EventClass& event) {
@@ -21,12 +35,33 @@ namespace PAX {
             (object->*Method)(event);
         };
 
+        template<typename EventClass>
+        static void deleteDelegates(void * delegates) {
+            delete static_cast<std::vector<Delegate<EventClass&>>*>(delegates);
+        }
+
+        static bool isBefore(const ListenerList & listenerList, TypeIndex event) {
+            return listenerList.event < event;
+        }
+
+        /**
+         * @return The delegates for the event class with the given index or nullptr if there are none.
+         */
+        PAX_NODISCARD void * findDelegates(TypeIndex event) const;
+
+        /**
+         * @return The delegates for the event class with the given index.
+         *         If there are none yet, the given delegates are inserted and returned.
+         */
+        void * findOrInsertDelegates(const ListenerList & listenerList);
+
     public:
         EventService() = default;
         EventService(const EventService & other) = delete;
         EventService(const EventService && other) = delete;
         EventService & operator=(const EventService & other) = delete;
         EventService & operator=(const EventService && other) = delete;
+        ~EventService();
 
         void setParent(EventService *parent);
         EventService* getParent();
@@ -36,14 +71,11 @@ namespace PAX {
 
         template<typename EventClass, typename Listener, void (Listener::*Method)(EventClass&)>
         void add(Listener* listener) {
-            PAX_ES_MAP_VALUES* listenerList;
-
-            const auto & listenerListIt = _listeners.find(typeid(EventClass));
-            if (listenerListIt != _listeners.end())
-                listenerList = static_cast<PAX_ES_MAP_VALUES*>(listenerListIt->second);
-            else {
+            const TypeIndex event = paxtypeindex(EventClass);
+            PAX_ES_MAP_VALUES* listenerList = static_cast<PAX_ES_MAP_VALUES*>(findDelegates(event));
+            if (!listenerList) {
                 listenerList = new PAX_ES_MAP_VALUES;
-                _listeners[typeid(EventClass)] = listenerList;
+                findOrInsertDelegates({event, listenerList, &deleteDelegates<EventClass>});
             }
 
             PAX_ES_DELEGATE delegate(listener, &invoke<EventClass, Listener, Method>);
@@ -54,9 +86,7 @@ namespace PAX {
 
         template<typename EventClass, typename Listener, void (Listener::*Method)(EventClass&)>
         bool remove(Listener *listener) {
-            const auto & listenerListIt = _listeners.find(typeid(EventClass));
-            if (listenerListIt != _listeners.end()) {
-                PAX_ES_MAP_VALUES* vec = static_cast<PAX_ES_MAP_VALUES*>(listenerListIt->second);
+            if (auto * vec = static_cast<PAX_ES_MAP_VALUES*>(findDelegates(paxtypeindex(EventClass)))) {
                 return PAX::Util::removeFromVector(*vec, PAX_ES_DELEGATE(listener, &invoke<EventClass, Listener, Method>));
             }
 
@@ -70,9 +100,7 @@ namespace PAX {
 
         template<typename EventClass>
         void fire(EventClass& event) {
-            const auto & listener = _listeners.find(typeid(EventClass));
-            if (listener != _listeners.end()) {
-                PAX_ES_MAP_VALUES *values = static_cast<PAX_ES_MAP_VALUES *>(listener->second);
+            if (auto * values = static_cast<PAX_ES_MAP_VALUES *>(findDelegates(paxtypeindex(EventClass)))) {
                 for (PAX_ES_DELEGATE &delegate : *values) {
                     delegate.method(delegate.callee, event);
 
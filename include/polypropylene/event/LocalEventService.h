@@ -0,0 +1,74 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_LOCALEVENTSERVICE_H
+#define POLYPROPYLENE_LOCALEVENTSERVICE_H
+
+#include <memory>
+#include "EventService.h"
+
+namespace PAX {
+    /**
+     * An EventService that is allocated only when the first listener is added.
+     * Most entities never get a listener of their own, so they should not pay for a full EventService.
+     * Until then, events fired on a LocalEventService are forwarded to its parent directly.
+     * Listeners added to the allocated service are kept until the LocalEventService is destroyed.
+     */
+    class LocalEventService {
+        EventService * parent = nullptr;
+        std::unique_ptr<EventService> service;
+
+    public:
+        LocalEventService() = default;
+        LocalEventService(const LocalEventService & other) = delete;
+        LocalEventService(const LocalEventService && other) = delete;
+        LocalEventService & operator=(const LocalEventService & other) = delete;
+        LocalEventService & operator=(const LocalEventService && other) = delete;
+        ~LocalEventService();
+
+        void setParent(EventService * parent);
+        PAX_NODISCARD EventService * getParent() const;
+
+        /**
+         * @return The allocated EventService or nullptr if no listener was added yet.
+         */
+        PAX_NODISCARD EventService * get() const;
+
+        /**
+         * @return The EventService holding the listeners of this service.
+         *         Allocates it on the first call.
+         */
+        EventService & getOrCreate();
+
+        template<typename EventClass, typename Listener, void (Listener::*Method)(EventClass&)>
+        void add(Listener* listener) {
+            getOrCreate().add<EventClass, Listener, Method>(listener);
+        }
+
+        template<typename EventClass, typename Listener, void (Listener::*Method)(EventClass&)>
+        bool remove(Listener *listener) {
+            if (service) {
+                return service->remove<EventClass, Listener, Method>(listener);
+            }
+
+            return false;
+        }
+
+        template<typename EventClass>
+        void operator()(EventClass& event) {
+            fire(event);
+        }
+
+        template<typename EventClass>
+        void fire(EventClass& event) {
+            if (service) {
+                service->fire(event);
+            } else if (parent) {
+                parent->fire(event);
+            }
+        }
+    };
+}
+
+#endif //POLYPROPYLENE_LOCALEVENTSERVICE_H
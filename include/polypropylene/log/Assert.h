@@ -17,7 +17,7 @@
     #define PAX_DEBUGASSERT(...) PAX_ASSERT(__VA_ARGS__)
 #else
     // As the arguments to the assertion might be side-effectual, still use them.
-    #define PAX_DEBUGASSERT(...) (__VA_ARGS__)
+    #define PAX_DEBUGASSERT(...) ((void) (__VA_ARGS__))
 #endif
 
 #endif //POLYPROPYLENE_ASSERT_H
@@ -5,13 +5,24 @@
 #ifndef POLYPROPYLENE_PROPERTYALLOCATIONSERVICE_H
 #define POLYPROPYLENE_PROPERTYALLOCATIONSERVICE_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <functional>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <vector>
 
 #include <polypropylene/stdutils/CollectionUtils.h>
 #include "polypropylene/reflection/TypeMap.h"
+#include "polypropylene/io/Path.h"
 
+#include "polypropylene/log/Assert.h"
 #include "Allocator.h"
+#include "Handle.h"
 #include "allocators/PoolAllocator.h"
 
 namespace PAX {
@@ -20,15 +31,103 @@ namespace PAX {
      * In Polypropylene, the AllocationService is used for allocating and deallocating properties.
      * For each type, a custom allocator can be registered.
      * By default, a PoolAllocator will be registered for each type lazily.
+     * By default, an AllocationService must not be used from multiple threads simultaneously.
+     * @see setThreadSafe for using it from multiple threads.
      */
     class AllocationService final {
     public:
         using AllocatorFactory = std::function<std::shared_ptr<Allocator>(const Type&)>;
 
+        /// Destroys the object at the given memory without freeing it (@ref destroyAll).
+        using Destructor = void(*)(void*);
+
     private:
+        /// Unique id of this service that is never reused, such that slots can identify the service they belong to.
+        const uint64_t id;
+
         TypeMap<std::shared_ptr<Allocator>> allocators;
         AllocatorFactory allocatorFactory;
 
+        bool threadSafe = false;
+        mutable std::shared_mutex allocatorsMutex;
+
+        /// Expected number of simultaneous allocations per type name (@ref loadHighWaterMarks).
+        std::map<std::string, size_t> capacityHints;
+
+        /**
+         * Destructors of all types whose destructor is known (@ref registerDestructor).
+         * Trivially destructible types are mapped to nullptr.
+         */
+        TypeMap<Destructor> destructors;
+
+        /// True while destroyAll runs destructors.
+        bool destroyingAll = false;
+
+        void addDestructor(const TypeId & type, Destructor destructor);
+
+        /// Increased whenever an allocator is registered or unregistered to invalidate all slots.
+        std::atomic<uint64_t> version { 0 };
+
+        /**
+         * Allocators that were replaced or unregistered while this service was thread-safe.
+         * Other threads may still use them through their slots until they notice the new version,
+         * so they are kept alive until this service is destroyed.
+         */
+        std::vector<std::shared_ptr<Allocator>> retiredAllocators;
+
+        /**
+         * Caches the allocator of a type, such that pax_new and pax_delete do not have to look it up each time.
+         * There is one slot per static type, purpose, and thread (@ref SlotOf).
+         * The slot does not own its allocator, such that slots never keep the pools of destroyed services alive.
+         * The allocator is only used if the slot belongs to this service (ids are never reused) and the version
+         * did not change since. Allocators that were replaced concurrently are retired instead of destroyed.
+         */
+        struct AllocatorSlot {
+            uint64_t service = ~uint64_t(0);
+            uint64_t version = 0;
+            TypeId type = paxtypeid(void);
+            Allocator * allocator = nullptr;
+        };
+
+        /// Purposes of slots (@ref SlotOf).
+        struct ForAllocation {};
+        struct ForDeletion {};
+
+        /**
+         * Allocations and deletions use separate slots, as deleteAndFree caches the allocator of the dynamic type
+         * of the deleted object, which would otherwise evict the allocator cached for allocate<T> and vice versa.
+         */
+        template<typename T, typename Purpose>
+        static AllocatorSlot & SlotOf() {
+            static thread_local AllocatorSlot slot;
+            return slot;
+        }
+
+        PAX_NODISCARD bool isUpToDate(const AllocatorSlot & slot, const TypeId & type, uint64_t currentVersion) const {
+            return slot.service == id && slot.version == currentVersion && slot.type == type;
+        }
+
+        /**
+         * @return The allocator registered for the given type or nullptr if there is none.
+         */
+        PAX_NODISCARD std::shared_ptr<Allocator> findAllocator(const TypeId & type) const;
+
+        std::shared_lock<std::shared_mutex> lockForReading() const;
+        std::unique_lock<std::shared_mutex> lockForWriting() const;
+
+        /**
+         * @return The capacity hint for the given type or 0 if there is none.
+         * Assumes that this service is locked.
+         */
+        PAX_NODISCARD size_t capacityHintOf(const Type & type) const;
+
+        /**
+         * @return The allocator registered for the given type.
+         *         Creates one with the default allocator factory if there is none yet.
+         *         Keep the returned pointer while using the allocator, as other threads may unregister it meanwhile.
+         */
+        PAX_NODISCARD std::shared_ptr<Allocator> getOrCreateAllocator(const Type & t);
+
     public:
         AllocationService();
         virtual ~AllocationService();
@@ -40,12 +139,83 @@ namespace PAX {
          * If no allocator is registered for the given type, a new allocator will
          * be created for the given type with the default allocator factory.
          * The default value of this creates PoolAllocators of default capacity.
+         * To share pools across types of similar size, use SizeClassAllocator::CreateFactory().
          * @param factory The factory to create default allocators with.
          */
         PAX_MAYBEUNUSED void setDefaultAllocatorFactory(const AllocatorFactory & factory);
 
+        /**
+         * Enables or disables the thread-safe mode of this AllocationService.
+         * In thread-safe mode, allocate, free, and all other methods may be called from multiple threads simultaneously.
+         * Each allocator created by the default allocator factory in thread-safe mode
+         * is wrapped into a ConcurrentAllocator that caches chunks per thread, unless it is thread-safe already.
+         * Allocators that are registered manually have to be thread-safe themselves.
+         * Allocators that were created before enabling thread-safe mode are not made thread-safe.
+         * Hence, enable thread-safe mode before any allocations are made.
+         * Beware that PropertyPools flush the caches of all threads when being iterated.
+         * So do not iterate a PropertyPool while other threads allocate or free properties of its type.
+         * @param threadSafe True iff this service should be usable from multiple threads.
+         */
+        PAX_MAYBEUNUSED void setThreadSafe(bool threadSafe);
+
+        /**
+         * @return True iff this AllocationService is in thread-safe mode.
+         */
+        PAX_NODISCARD bool isThreadSafe() const;
+
+        /**
+         * Writes the peak number of simultaneous allocations of each type to the given file.
+         * Load the file in a later run with loadHighWaterMarks to create pools of the right size right away.
+         * Only allocators that track their allocations are considered (@ref Allocator::getPeakNumberOfAllocations).
+         * Types of allocators that were unregistered are not considered.
+         * @param path The file to write to. It is overwritten if it exists.
+         * @return True iff the file could be written.
+         */
+        PAX_MAYBEUNUSED bool saveHighWaterMarks(const Path & path) const;
+
+        /**
+         * Loads high-water marks written by saveHighWaterMarks in a previous run.
+         * Types are identified by their name, so the file is only meaningful for the same build.
+         * Pools that are created for the loaded types afterwards reserve enough pages of default capacity
+         * for the loaded number of objects right away.
+         * Pools that already exist are not resized.
+         * Hence, load the high-water marks before any allocations are made.
+         * @param path The file to read.
+         * @return True iff the file could be read.
+         */
+        PAX_MAYBEUNUSED bool loadHighWaterMarks(const Path & path);
+
+        /**
+         * @param type The type for which a PoolAllocator should be created.
+         * @return The number of objects of the given type a new pool should reserve memory for
+         *         (@ref PoolAllocator::reserve).
+         *         This is the loaded high-water mark of the given type (@ref loadHighWaterMarks) if present and 0 otherwise.
+         */
+        PAX_NODISCARD size_t getCapacityHintFor(const Type & type) const;
+
+        /**
+         * @return A snapshot of the memory usage of the allocator registered for each type (@ref Allocator::getStatistics).
+         */
+        PAX_NODISCARD TypeMap<AllocatorStatistics> getStatistics() const;
+
+        /**
+         * Writes the statistics of all allocators (@ref getStatistics) as a JSON array to the given stream.
+         * Each element is an object with the name of the type, the name of its allocator, and all statistics.
+         * @param stream The stream to write to.
+         */
+        void writeStatistics(std::ostream & stream) const;
+
+        /**
+         * Writes the statistics of all allocators as JSON to the given file (@ref writeStatistics).
+         * @param path The file to write to. It is overwritten if it exists.
+         * @return True iff the file could be written.
+         */
+        PAX_MAYBEUNUSED bool saveStatistics(const Path & path) const;
+
         /**
          * Registers the given allocator for (de-) allocating objects of the given type.
+         * If this service is thread-safe, a previously registered allocator is kept alive until this service is
+         * destroyed, as other threads might still use it.
          */
         void registerAllocator(const TypeId & type, const std::shared_ptr<Allocator> & allocator);
 
@@ -62,6 +232,8 @@ namespace PAX {
          * objects anymore because it was removed.
          * So remove an allocator only, if there are no objects allocated with
          * it around anymore!
+         * If this service is thread-safe, it keeps the removed allocator alive until it is destroyed,
+         * as other threads might still use it.
          *
          * @param type The type for which the current allocator should be removed.
          * @return The removed allocator.
@@ -98,6 +270,52 @@ namespace PAX {
          */
         PAX_NODISCARD void * allocate(const Type & t);
 
+        /**
+         * Allocates memory for an object of type T.
+         * In contrast to allocate(const Type & t), the allocator for T is looked up only once
+         * and cached afterwards until allocators are registered or unregistered.
+         * This is used by pax_new.
+         * The destructor of T is registered for destroyAll.
+         * @tparam T The type for which memory should be allocated.
+         * In debug builds, the returned memory is asserted to be aligned to alignof(T).
+         * @return A pointer to new memory of size 'sizeof(T)'.
+         */
+        template<typename T>
+        PAX_NODISCARD void * allocate() {
+            AllocatorSlot & slot = SlotOf<T, ForAllocation>();
+            // Read the version before the lookup such that concurrent (un)registrations invalidate the slot.
+            const uint64_t currentVersion = version.load(std::memory_order_acquire);
+            if (!isUpToDate(slot, paxtypeid(T), currentVersion)) {
+                slot = AllocatorSlot { id, currentVersion, paxtypeid(T), getOrCreateAllocator(paxtypeof(T)).get() };
+                registerDestructor<T>();
+            }
+            void * data = slot.allocator->allocate();
+            PAX_DEBUGASSERT(reinterpret_cast<std::uintptr_t>(data) % alignof(T) == 0);
+            return data;
+        }
+
+        /**
+         * Allocates memory for n objects of the given type at once.
+         * In contrast to calling allocate n times, the allocator for the given type is looked up only once
+         * and may claim the memory in bulk (@ref Allocator::allocateN).
+         * Use this when creating many objects of the same type at once (e.g., when loading a level).
+         * @param t The type for which memory should be allocated.
+         * @param n The number of objects to allocate memory for.
+         * @return n pointers to new memory of size 't.size' each.
+         */
+        PAX_NODISCARD std::vector<void*> allocateBatch(const Type & t, size_t n);
+
+        /**
+         * Frees memory for multiple objects of the given type at once.
+         * Like free, this does not invoke any destructors.
+         * Throws a runtime error if there is no allocator registered for the given type
+         * or if any of the given memory was not allocated with this AllocationService.
+         * @param type The type for which the given memory was allocated.
+         * @param memory The memory that should be freed.
+         * @return True iff all memory was freed successfully.
+         */
+        PAX_NODISCARD bool freeBatch(const TypeId & type, const std::vector<void*> & memory);
+
         /**
          * Frees the given memory that was allocated used for objects of the given type.
          * This method assumes that the given memory was allocated with this AllocationService.
@@ -132,9 +350,21 @@ namespace PAX {
          */
         template<typename DestructorType>
         PAX_NODISCARD bool deleteAndFree(DestructorType * t, const TypeId & type) {
-            if (hasAllocated(type, t)) {
+            // The slot of the static type caches the allocator of the most recently deleted dynamic type.
+            AllocatorSlot & slot = SlotOf<DestructorType, ForDeletion>();
+            const uint64_t currentVersion = version.load(std::memory_order_acquire);
+            Allocator * allocator = slot.allocator;
+            if (!isUpToDate(slot, type, currentVersion)) {
+                // Registered allocators live as long as this service or are retired, so we do not need ownership.
+                allocator = findAllocator(type).get();
+                if (allocator) {
+                    slot = AllocatorSlot { id, currentVersion, type, allocator };
+                }
+            }
+
+            if (allocator && allocator->isMine(t)) {
                 t->~DestructorType();
-                return free(type, t);
+                return allocator->free(t);
             }
             return false;
         }
@@ -143,6 +373,76 @@ namespace PAX {
         PAX_NODISCARD bool deleteAndFree(DestructorType * t) {
             return deleteAndFree(t, paxtypeid(DestructorType));
         }
+
+        /**
+         * Registers the destructor of T to be run by destroyAll.
+         * If T is trivially destructible, T is only remembered to not need destruction.
+         * Destructors are registered automatically when allocating with allocate<T>() (e.g., via pax_new).
+         * @tparam T The type whose destructor should be registered.
+         */
+        template<typename T>
+        void registerDestructor() {
+            PAX_CONSTEXPR_IF (std::is_trivially_destructible<T>::value) {
+                addDestructor(paxtypeid(T), nullptr);
+            } else {
+                addDestructor(paxtypeid(T), [](void * t) { static_cast<T*>(t)->~T(); });
+            }
+        }
+
+        /**
+         * Destroys all objects allocated with this AllocationService at once, e.g., to tear down a whole world.
+         * In contrast to deleting each object with deleteAndFree, the pools are walked linearly
+         * and destructors are run for types with a registered destructor (@ref registerDestructor).
+         * Objects of types whose destructor is unknown (e.g., allocated via allocate(const Type &) or allocateBatch only)
+         * are freed without being destroyed and a warning is logged.
+         * Afterwards, each pool is freed in a single step (@ref PoolAllocator::freeAll), so all handles become invalid.
+         * Destructors must neither access nor delete other objects of this service.
+         * Entities skip deleting their properties while this runs (@ref isDestroyingAll).
+         * Only call this while no other thread uses this service.
+         * @return True iff all objects were destroyed.
+         *         False if there are objects of types whose allocator is not backed by a dedicated PoolAllocator
+         *         (e.g., SizeClassAllocators or ChainedAllocators). Those objects are left untouched.
+         *         False if objects of types with unknown destructor were freed.
+         */
+        bool destroyAll();
+
+        /**
+         * @return True iff destroyAll is currently running destructors.
+         */
+        PAX_NODISCARD bool isDestroyingAll() const;
+
+        /**
+         * Returns the PoolAllocator that allocates objects of the given type.
+         * PoolAllocators that are made thread-safe by a ConcurrentAllocator, shared by a SizeClassAllocator,
+         * or chained as primary allocator of a ChainedAllocator are found, too.
+         * @param type The type for which the pool should be returned.
+         * @return The PoolAllocator registered for the given type.
+         *         Returns nullptr if there is no allocator registered for the given type
+         *         or if it is not a PoolAllocator.
+         */
+        PAX_NODISCARD PoolAllocator * getPoolAllocator(const TypeId & type);
+
+        /**
+         * Creates a handle to the given object that was allocated with this AllocationService.
+         * @param t The object to create a handle for.
+         * @param type The dynamic type of the given object for which it was allocated.
+         * @return A handle to the given object.
+         *         Returns an invalid handle if the given object was not allocated in a PoolAllocator
+         *         of this AllocationService.
+         */
+        template<typename T>
+        PAX_NODISCARD Handle<T> getHandle(T * t, const TypeId & type) {
+            PoolAllocator * pool = getPoolAllocator(type);
+            if (pool && pool->getIndexOf(t) >= 0) {
+                return Handle<T>(*pool, t);
+            }
+            return Handle<T>();
+        }
+
+        template<typename T>
+        PAX_NODISCARD Handle<T> getHandle(T * t) {
+            return getHandle(t, paxtypeid(T));
+        }
     };
 }
 #endif //POLYPROPYLENE_PROPERTYALLOCATIONSERVICE_H
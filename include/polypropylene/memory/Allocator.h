@@ -6,10 +6,47 @@
 #define POLYPROPYLENE_PROPERTYALLOCATOR_H
 
 //#include <cstddef> // for size_t
+#include <cstdint>
 #include <string>
 #include "polypropylene/definitions/Definitions.h"
 
+/**
+ * Adds n to the given counter of total allocations or frees.
+ * Compiles to nothing unless PAX_WITH_ALLOCATOR_STATISTICS is defined.
+ */
+#ifdef PAX_WITH_ALLOCATOR_STATISTICS
+#define PAX_ALLOCATOR_COUNT(counter, n) (counter) += (n);
+#else
+#define PAX_ALLOCATOR_COUNT(counter, n)
+#endif
+
 namespace PAX {
+    /**
+     * A snapshot of the memory usage of an allocator (@ref Allocator::getStatistics).
+     */
+    struct AllocatorStatistics {
+        /// The number of objects that are currently allocated.
+        size_t liveObjects = 0;
+        /// The maximum number of objects that were allocated simultaneously.
+        size_t peakObjects = 0;
+        /// The number of allocations since the allocator was created. Always 0 without PAX_WITH_ALLOCATOR_STATISTICS.
+        uint64_t totalAllocations = 0;
+        /// The number of frees since the allocator was created. Always 0 without PAX_WITH_ALLOCATOR_STATISTICS.
+        uint64_t totalFrees = 0;
+        /// The number of allocations that overflowed to a secondary allocator (@ref ChainedAllocator).
+        uint64_t spills = 0;
+        /// The number of bytes the allocator obtained for storing objects.
+        size_t bytesReserved = 0;
+        /// The number of bytes occupied by the live objects.
+        size_t bytesUsed = 0;
+        /**
+         * The fraction of free chunks between the first and the last allocated chunk.
+         * Iterating the allocator has to step over these holes.
+         * 0 for allocators without a notion of chunk order.
+         */
+        double holeRatio = 0;
+    };
+
     /**
      * Interface for memory allocators.
      */
@@ -37,6 +74,24 @@ namespace PAX {
          */
         PAX_NODISCARD virtual bool free(void * data) = 0;
 
+        /**
+         * Allocates the given number of memory chunks at once.
+         * By default, this calls allocate() for each chunk.
+         * Allocators may override this with a faster implementation.
+         * @param count The number of chunks to allocate.
+         * @param out Array of at least count elements to which the allocated chunks are written.
+         */
+        virtual void allocateN(size_t count, void ** out);
+
+        /**
+         * Frees the given memory chunks at once.
+         * By default, this calls free() for each chunk.
+         * @param data Array of chunks that were allocated with this allocator.
+         * @param count The number of chunks in data.
+         * @return The number of chunks that were successfully freed.
+         */
+        PAX_NODISCARD virtual size_t freeN(void * const * data, size_t count);
+
         /**
          * @return True iff the given memory was allocated by this allocator.
          */
@@ -47,6 +102,30 @@ namespace PAX {
          */
         PAX_NODISCARD virtual size_t getAllocationSize() const = 0;
 
+        /**
+         * @return The alignment in bytes that each allocated data object is guaranteed to have.
+         *         Returns alignof(std::max_align_t) by default, which is what malloc guarantees.
+         */
+        PAX_NODISCARD virtual size_t getAlignment() const;
+
+        /**
+         * @return True iff this allocator may be used from multiple threads simultaneously.
+         *         Returns false by default.
+         */
+        PAX_NODISCARD virtual bool isThreadSafe() const;
+
+        /**
+         * @return The maximum number of objects that were allocated simultaneously with this allocator so far.
+         *         Returns 0 if this allocator does not track its allocations (default).
+         */
+        PAX_NODISCARD virtual size_t getPeakNumberOfAllocations() const;
+
+        /**
+         * @return A snapshot of the memory usage of this allocator.
+         *         By default, only the peak number of allocations is given.
+         */
+        PAX_NODISCARD virtual AllocatorStatistics getStatistics() const;
+
         PAX_NODISCARD const std::string & getName() const;
     };
 }
@@ -0,0 +1,94 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_HANDLE_H
+#define POLYPROPYLENE_HANDLE_H
+
+#include "allocators/PoolAllocator.h"
+
+namespace PAX {
+    /**
+     * A reference to an object allocated in a PoolAllocator that notices when the object was deleted.
+     * Raw pointers silently alias a new object once the chunk of a deleted object is reused by the pool.
+     * A Handle instead remembers the generation of the chunk when it was created.
+     * As the generation of a chunk changes whenever the chunk is freed, resolving a Handle
+     * takes a single comparison and yields nullptr for deleted objects.
+     * Thus, handles can be cached across frames safely instead of querying entities for their properties again.
+     *
+     * Beware that the PoolAllocator the object was allocated in has to outlive the Handle.
+     * Handles are not synchronised, so do not resolve them while other threads allocate objects of the same type.
+     * If the pool is used from multiple threads via a ConcurrentAllocator, handles are only invalidated
+     * once the chunk of a deleted object is given back to the pool (@ref ConcurrentAllocator::flush).
+     * Handles are created with AllocationService::getHandle or pax_handle.
+     * @tparam T The type of the referenced object.
+     */
+    template<typename T>
+    class Handle {
+        const PoolAllocator * pool = nullptr;
+        T * object = nullptr;
+        PoolAllocator::Index index = -1;
+        PoolAllocator::Generation generation = 0;
+
+    public:
+        /**
+         * Creates an invalid handle that does not reference any object.
+         */
+        Handle() = default;
+
+        /**
+         * Creates a handle to the given object.
+         * @param pool The pool the given object was allocated in.
+         * @param object An object that is currently allocated in the given pool.
+         */
+        Handle(const PoolAllocator & pool, T * object) :
+        pool(&pool),
+        object(object),
+        index(pool.getIndexOf(object))
+        {
+            if (index < 0) {
+                PAX_THROW_RUNTIME_ERROR("Cannot create handle to " << object << " because it was not allocated by PoolAllocator " << pool.getName() << "!");
+            }
+            generation = pool.getGeneration(index);
+        }
+
+        /**
+         * @return The referenced object if it was not deleted yet. Returns nullptr otherwise.
+         */
+        PAX_NODISCARD T * get() const {
+            if (pool && pool->getGeneration(index) == generation) {
+                return object;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @return True iff the referenced object was not deleted yet.
+         */
+        PAX_NODISCARD bool isValid() const {
+            return get() != nullptr;
+        }
+
+        explicit operator bool() const {
+            return isValid();
+        }
+
+        T * operator->() const {
+            return get();
+        }
+
+        T & operator*() const {
+            return *get();
+        }
+
+        bool operator==(const Handle & other) const {
+            return pool == other.pool && index == other.index && generation == other.generation;
+        }
+
+        bool operator!=(const Handle & other) const {
+            return !(*this == other);
+        }
+    };
+}
+
+#endif //POLYPROPYLENE_HANDLE_H
@@ -0,0 +1,70 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_PAGEMEMORY_H
+#define POLYPROPYLENE_PAGEMEMORY_H
+
+#include <cstddef>
+#include "polypropylene/definitions/Definitions.h"
+
+namespace PAX {
+    /**
+     * Requests memory for large blocks, such as the pages of a PoolAllocator, directly from the operating system.
+     * On POSIX systems, blocks spanning at least one page of the operating system are mapped with mmap.
+     * Such memory is only reserved but not committed until it is touched for the first time,
+     * so large blocks do not add to the resident memory of the process unless they are used.
+     * On other systems and for smaller blocks, memory is obtained from the aligned operator new.
+     */
+    namespace PageMemory {
+        /**
+         * @return The size of a page of the operating system in bytes.
+         */
+        PAX_NODISCARD size_t getSystemPageSize();
+
+        /**
+         * @return True iff a block of the given size and alignment is mapped from the operating system
+         *         when allocated with allocate().
+         *         Only mapped blocks can be decommitted or backed by huge pages.
+         */
+        PAX_NODISCARD bool isMapped(size_t bytes, size_t alignment);
+
+        /**
+         * Allocates a block of memory.
+         * Throws std::bad_alloc if there is not enough memory.
+         * @param bytes The size of the block.
+         * @param alignment The alignment of the block. Has to be a power of two.
+         * @param hugePages If true, the operating system is advised to back the block with huge pages (if mapped).
+         * @return The allocated block. Has to be released with free() using the same size and alignment.
+         */
+        PAX_NODISCARD void * allocate(size_t bytes, size_t alignment, bool hugePages = false);
+
+        /**
+         * Releases a block obtained from allocate().
+         * The given size and alignment have to be the same that were passed to allocate().
+         */
+        void free(void * block, size_t bytes, size_t alignment);
+
+        /**
+         * Advises the operating system to (not) back the given mapped block with huge pages.
+         * Does nothing for blocks that are not mapped.
+         */
+        void adviseHugePages(void * block, size_t bytes, size_t alignment, bool hugePages);
+
+        /**
+         * Returns the physical memory of the trailing system pages of the given mapped block,
+         * starting at the first system page boundary at or after the given offset, to the operating system.
+         * The addresses stay valid but the content of the decommitted region is lost (it reads as zeros on Linux).
+         * Touching the region again commits it again.
+         * Does nothing for blocks that are not mapped.
+         * @param block A block obtained from allocate().
+         * @param bytes The size of the block as passed to allocate().
+         * @param alignment The alignment of the block as passed to allocate().
+         * @param offset The offset in bytes into the block from which on memory may be decommitted.
+         * @return The number of bytes that were returned to the operating system.
+         */
+        size_t decommitTail(void * block, size_t bytes, size_t alignment, size_t offset);
+    }
+}
+
+#endif //POLYPROPYLENE_PAGEMEMORY_H
@@ -6,7 +6,9 @@
 #define POLYPROPYLENE_PROPERTYPOOL_H
 
 #include "AllocationService.h"
+#include "allocators/ConcurrentAllocator.h"
 #include "allocators/PoolAllocator.h"
+#include "allocators/SizeClassAllocator.h"
 
 namespace PAX {
     struct PAX_MAYBEUNUSED DefaultChunkValidator {
@@ -15,9 +17,10 @@ namespace PAX {
 
     /**
      * Iterator for pool allocators.
-     * This is a naive implementations that steps over all memory chunks in a pool allocator
-     * and inspects if these are allocated or not.
-     * Returns allocated chunks and skips invalid ones.
+     * Steps over the allocated memory chunks in a pool allocator only.
+     * Free chunks are skipped by inspecting the pool's allocation bitmap, 64 chunks at a time,
+     * such that the chunks themselves are never touched.
+     * Of the allocated chunks, only those are returned that are valid according to the given validator.
      * @tparam PropertyType The type of property this iterator iterates over.
      */
     template<typename PropertyType, typename ValidatorType = DefaultChunkValidator>
@@ -34,9 +37,9 @@ namespace PAX {
         using Validator = ValidatorType;
 
         static PropertyPoolIterator BeginOf(PoolAllocator & pool, const ValidatorType & validator) {
-            PoolAllocator::Index current = pool.begin();
+            PoolAllocator::Index current = pool.nextAllocated(pool.begin());
             while (current < pool.end() && !validator.isValid(pool, current)) {
-                ++current;
+                current = pool.nextAllocated(current + 1);
             }
             return PropertyPoolIterator(pool, current, validator);
         }
@@ -60,10 +63,10 @@ namespace PAX {
         }
 
         PropertyPoolIterator & operator++() {
-            // Step over all invalid memory chunks.
+            // Step over all free and invalid memory chunks.
             if (current < pool.end()) {
                 do {
-                    ++current;
+                    current = pool.nextAllocated(current + 1);
                 } while (current < pool.end() && !validator.isValid(pool, current));
             }
             return *this;
@@ -85,31 +88,65 @@ namespace PAX {
         static constexpr size_t PropSize = sizeof(PropertyType);
         std::shared_ptr<PoolAllocator> pool;
 
+        /// Set if the pool is used from multiple threads (@ref AllocationService::setThreadSafe).
+        std::shared_ptr<ConcurrentAllocator> concurrentPool;
+
     public:
         using Property = PropertyType;
         using Iterator = IteratorType;
         using Validator = typename Iterator::Validator;
 
-        PropertyPool() {
+        /**
+         * Creates a pool of the properties allocated with the AllocationService currently bound
+         * to the property's entity type (@ref Entity::GetAllocationService).
+         */
+        PropertyPool() : PropertyPool(Property::EntityType::GetAllocationService()) {}
+
+        /**
+         * Creates a pool of the properties allocated with the given AllocationService (e.g., that of a world).
+         * Throws if the allocator registered for PropertyType shares its pool with other types (@ref SizeClassAllocator),
+         * as iterating or compacting that pool would treat objects of other types as properties.
+         * Throws if there is an allocator registered for PropertyType that is not a PoolAllocator
+         * (e.g., a ChainedAllocator), as its objects cannot be iterated.
+         */
+        explicit PropertyPool(AllocationService & allocationService) {
             const Type propType = paxtypeof(Property);
-            AllocationService & allocationService = Property::EntityType::GetAllocationService();
             const std::shared_ptr<Allocator> & existingAllocator = allocationService.getAllocator(propType.id);
 
             // If there is already an allocator registered for our property type ...
             if (existingAllocator) {
-                // ... See if it is a PoolAllocator.
+                // ... make sure its pool does not contain objects of other types ...
+                const auto * concurrent = dynamic_cast<const ConcurrentAllocator*>(existingAllocator.get());
+                if (dynamic_cast<const SizeClassAllocator*>(concurrent ? concurrent->getBackend().get() : existingAllocator.get())) {
+                    PAX_THROW_RUNTIME_ERROR("Cannot create PropertyPool for " << propType.name() << " because its allocator " << existingAllocator->getName() << " shares its pool with other types of the same size class!");
+                }
+
+                // ... See if it is a PoolAllocator, potentially made thread-safe.
                 pool = std::dynamic_pointer_cast<PoolAllocator>(existingAllocator);
+                concurrentPool = std::dynamic_pointer_cast<ConcurrentAllocator>(existingAllocator);
+                if (concurrentPool) {
+                    pool = std::dynamic_pointer_cast<PoolAllocator>(concurrentPool->getBackend());
+                    if (!pool) {
+                        concurrentPool = nullptr;
+                    }
+                }
                 if (!pool) {
-                    // If it is not, remove it because we will replace it.
-                    allocationService.unregisterAllocator(propType.id);
+                    // We cannot iterate it but must not replace it either, as objects allocated with it might still be alive.
+                    PAX_THROW_RUNTIME_ERROR("Cannot create PropertyPool for " << propType.name() << " because its allocator " << existingAllocator->getName() << " is not a PoolAllocator!");
                 }
             }
 
             // If we couldn't reuse an existing allocator.
             if (!pool) {
                 // create one
-                pool = std::make_shared<PoolAllocator>(propType.name(), PropSize);
-                allocationService.registerAllocator(propType.id, pool);
+                pool = std::make_shared<PoolAllocator>(propType.name(), PropSize, PoolAllocator::Index(PoolAllocator::GetDefaultCapacity()), PoolAllocator::UnlimitedCapacity, alignof(PropertyType));
+                pool->reserve(PoolAllocator::Index(allocationService.getCapacityHintFor(propType)));
+                if (allocationService.isThreadSafe()) {
+                    concurrentPool = std::make_shared<ConcurrentAllocator>(pool);
+                    allocationService.registerAllocator(propType.id, concurrentPool);
+                } else {
+                    allocationService.registerAllocator(propType.id, pool);
+                }
             }
         }
 
@@ -118,8 +155,59 @@ namespace PAX {
             return v;
         }
 
-        Iterator begin() const { return Iterator::BeginOf(*pool, getValidator()); }
+        /**
+         * If the pool is used from multiple threads, the chunks cached by all threads are flushed back to the pool first.
+         * So do not iterate while other threads allocate or free properties of this pool's type.
+         */
+        Iterator begin() const {
+            if (concurrentPool) {
+                concurrentPool->flush();
+            }
+            return Iterator::BeginOf(*pool, getValidator());
+        }
+
         Iterator end() const { return Iterator::EndOf(*pool, getValidator()); }
+
+        /**
+         * Moves properties from the back of the pool to free chunks at its front,
+         * such that iterating this pool does not have to step over holes anymore.
+         * Each property is moved with its move constructor (or copy constructor if it has none).
+         * If a moved property is attached to an entity, the entity's references to it are updated,
+         * the property is notified via Property::relocated, and a PropertyRelocatedEvent is sent to the entity.
+         * Any other raw pointers and handles to moved properties become invalid.
+         * If the pool is used from multiple threads, the chunks cached by all threads are flushed back to the pool first.
+         * So do not compact while other threads use properties of this pool's type.
+         * @param budget The time after which no further properties are moved. Call compact again later to continue.
+         * @return The number of properties that were moved.
+         * @see PoolAllocator::compact
+         */
+        PAX_MAYBEUNUSED size_t compact(std::chrono::nanoseconds budget = std::chrono::nanoseconds::max()) {
+            if (concurrentPool) {
+                concurrentPool->flush();
+            }
+
+            return pool->compact([](void * from, void * to) {
+                Property * oldLocation = static_cast<Property*>(from);
+                // The moved property belongs to the service of the old one (@ref Property::getAllocationService).
+                using EntityType = typename Property::EntityType;
+                AllocationService * bound = EntityType::BindAllocationService(&oldLocation->getAllocationService());
+                Property * property = new (to) Property(std::move(*oldLocation));
+                EntityType::BindAllocationService(bound);
+
+                // The old object is destroyed only after everyone was notified, such that they may still access it.
+                if (auto * owner = property->getOwner()) {
+                    owner->PAX_INTERNAL(relocate)(oldLocation, property);
+                }
+                oldLocation->~Property();
+            }, budget);
+        }
+
+        /**
+         * @return True iff the properties in this pool are stored without holes in between.
+         */
+        PAX_NODISCARD bool isCompact() const {
+            return pool->isCompact();
+        }
     };
 }
 
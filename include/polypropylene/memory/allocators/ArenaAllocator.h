@@ -0,0 +1,183 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_ARENAALLOCATOR_H
+#define POLYPROPYLENE_ARENAALLOCATOR_H
+
+#include "../Allocator.h"
+#include "polypropylene/reflection/Type.h"
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace PAX {
+    class ArenaAllocator;
+
+    /**
+     * Linear memory for short-lived objects.
+     * Memory is handed out by bumping a pointer through large blocks and is only reclaimed all at once by reset().
+     * Blocks are kept upon reset, such that an arena that is reset regularly (e.g., each frame) stops allocating
+     * memory from the system after the first few cycles.
+     * Objects are allocated in an arena via ArenaAllocators.
+     * Multiple ArenaAllocators for different types can share an arena to group all transient objects of a scope.
+     */
+    class Arena {
+        friend class ArenaAllocator;
+
+        struct Block {
+            char * memory;
+            size_t size;
+        };
+
+        const size_t blockSize;
+        std::vector<Block> blocks;
+        size_t currentBlock = 0;
+        size_t offset = 0;
+
+        /// Allocators with destructors that have to be run upon reset.
+        std::vector<ArenaAllocator*> destructingAllocators;
+
+        /**
+         * @return The index of the next block after the current one that has at least the given size.
+         *         Creates a new block if there is none.
+         */
+        size_t nextBlockFor(size_t size);
+
+    public:
+        static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+        /**
+         * @param blockSize The size in bytes of each block of memory.
+         *                  Objects that are bigger than this get a block of their own.
+         */
+        explicit Arena(size_t blockSize = DefaultBlockSize);
+        Arena(const Arena & other) = delete;
+        Arena & operator=(const Arena & other) = delete;
+
+        /**
+         * Destroys all objects of registered types (@ref reset) and releases all memory.
+         */
+        ~Arena();
+
+        /**
+         * @param size The number of bytes to allocate.
+         * @param alignment The alignment of the memory. Has to be a power of two.
+         * @return A pointer to uninitialised memory of the given size that is valid until the next reset.
+         */
+        PAX_NODISCARD void * allocate(size_t size, size_t alignment);
+
+        /**
+         * Reclaims all memory handed out by this arena at once.
+         * Runs the destructors of all objects that were allocated by ArenaAllocators with destructors
+         * and that were not freed before.
+         * Without such objects, this takes constant time.
+         * All pointers to memory of this arena become invalid.
+         */
+        void reset();
+
+        /**
+         * @return True iff the given pointer points into the memory of this arena.
+         */
+        PAX_NODISCARD bool contains(const void * data) const;
+
+        /**
+         * @return The number of bytes handed out since the last reset, including padding for alignment.
+         */
+        PAX_NODISCARD size_t getBytesUsed() const;
+
+        /**
+         * @return The number of blocks this arena holds.
+         */
+        PAX_NODISCARD size_t getNumberOfBlocks() const;
+    };
+
+    /**
+     * Allocates objects of a single type in an Arena.
+     * Allocation only bumps a pointer.
+     * Freeing does not reclaim any memory as the memory is reclaimed when the arena is reset.
+     * Register ArenaAllocators with AllocationService::registerAllocator for types whose instances live for a short
+     * time only (e.g., a single frame) and reset the arena periodically.
+     *
+     * If the allocated type is not trivially destructible, the allocator can be given a destructor
+     * (@ref ArenaAllocator::For) that is run for all objects that were not freed yet when the arena is reset.
+     * In that case, the allocator remembers its objects in a list and stores the index of each object in that list
+     * in a small header in front of it.
+     * Freeing an object thereby marks its entry as dead in constant time.
+     */
+    class ArenaAllocator : public Allocator {
+        friend class Arena;
+
+    public:
+        using Destructor = void (*)(void * object);
+
+    private:
+        const std::shared_ptr<Arena> arena;
+        const size_t elementSize;
+        const size_t alignment;
+        const Destructor destructor;
+
+        /// Bytes in front of each object that store its index in liveObjects. Only used if there is a destructor.
+        const size_t headerSize;
+
+        /// Objects that were allocated since the last reset. Freed objects are set to nullptr.
+        /// Only tracked if there is a destructor.
+        std::vector<void*> liveObjects;
+
+        /**
+         * Runs the destructor for all live objects.
+         */
+        void destroyAll();
+
+    public:
+        /**
+         * @param name The name of this allocator used for debug messages.
+         * @param elementSize The size of each allocated object.
+         * @param alignment The alignment of each allocated object. Has to be a power of two.
+         * @param arena The arena to allocate from.
+         * @param destructor If given, this is invoked on all objects that were not freed when the arena is reset.
+         */
+        ArenaAllocator(const std::string & name, size_t elementSize, size_t alignment, const std::shared_ptr<Arena> & arena, Destructor destructor = nullptr);
+        ~ArenaAllocator() override;
+
+        /**
+         * Creates an ArenaAllocator for objects of the given type.
+         * If the type is not trivially destructible, its destructor is run upon resetting the arena
+         * for all objects that were not freed (e.g., with pax_delete) before.
+         * @tparam T The type of the allocated objects.
+         * @param arena The arena to allocate from.
+         * @return An ArenaAllocator for objects of type T.
+         */
+        template<typename T>
+        PAX_NODISCARD static std::shared_ptr<ArenaAllocator> For(const std::shared_ptr<Arena> & arena) {
+            Destructor destructor = nullptr;
+            PAX_CONSTEXPR_IF (!std::is_trivially_destructible<T>::value) {
+                destructor = [](void * object) { static_cast<T*>(object)->~T(); };
+            }
+            return std::make_shared<ArenaAllocator>(paxtypeid(T).name(), sizeof(T), alignof(T), arena, destructor);
+        }
+
+        PAX_NODISCARD void * allocate() override;
+
+        /**
+         * Does not reclaim any memory. Memory is reclaimed by resetting the arena.
+         * This does not call the destructor of the given object, but prevents it from being called on reset.
+         * @return True iff the given object belongs to the arena of this allocator.
+         */
+        PAX_NODISCARD bool free(void * data) override;
+
+        /**
+         * @return True iff the given data belongs to the arena of this allocator.
+         */
+        PAX_NODISCARD bool isMine(void * data) const override;
+        PAX_NODISCARD size_t getAllocationSize() const override;
+        PAX_NODISCARD size_t getAlignment() const override;
+
+        /**
+         * @return The arena this allocator allocates from.
+         */
+        PAX_NODISCARD const std::shared_ptr<Arena> & getArena() const;
+    };
+}
+
+#endif //POLYPROPYLENE_ARENAALLOCATOR_H
@@ -0,0 +1,118 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_CHAINEDALLOCATOR_H
+#define POLYPROPYLENE_CHAINEDALLOCATOR_H
+
+#include "../AllocationService.h"
+#include "PoolAllocator.h"
+#include <atomic>
+#include <memory>
+
+namespace PAX {
+    /**
+     * Allocates from a primary allocator and spills over to a secondary allocator when the primary one is full.
+     * Thus, a PoolAllocator with a maximum capacity degrades gracefully under load spikes instead of throwing
+     * a "memory overflow" error.
+     * The secondary allocator may be another pool, a SlabAllocator, or a MallocAllocator and can be a ChainedAllocator itself.
+     * Memory is freed by the allocator it belongs to.
+     * Each allocation that had to be served by the secondary allocator is counted as a spill.
+     *
+     * If the primary allocator is a PoolAllocator, its fill level is checked before allocating.
+     * Any other primary allocator is considered full when its allocate() throws.
+     *
+     * Objects spilled to the secondary allocator cannot be iterated, so PropertyPool refuses ChainedAllocators.
+     * Do not chain allocators of properties that are iterated with a PropertyPool.
+     */
+    class ChainedAllocator : public Allocator {
+        const std::shared_ptr<Allocator> primary;
+        const std::shared_ptr<Allocator> secondary;
+
+        /// The primary allocator if it is a PoolAllocator. Used to check its fill level without throwing.
+        PoolAllocator * const primaryPool;
+
+        std::atomic<uint64_t> spills { 0 };
+
+        /**
+         * @return True iff the primary allocator cannot allocate any more chunks.
+         */
+        PAX_NODISCARD bool isPrimaryFull() const;
+
+    public:
+        /**
+         * Creates a ChainedAllocator.
+         * The given allocators must not be used directly anymore afterwards.
+         * @param primary The allocator to allocate from first.
+         * @param secondary The allocator to allocate from when the primary one is full.
+         *                  Its allocation size has to be at least that of primary.
+         */
+        ChainedAllocator(const std::shared_ptr<Allocator> & primary, const std::shared_ptr<Allocator> & secondary);
+
+        /**
+         * Allocates from the primary allocator if it is not full and from the secondary allocator otherwise.
+         */
+        PAX_NODISCARD void * allocate() override;
+
+        /**
+         * Allocates as many chunks as possible from the primary allocator and the rest from the secondary allocator.
+         */
+        void allocateN(size_t count, void ** out) override;
+
+        /**
+         * Frees the given data with the allocator it was allocated with.
+         * @return False if neither allocator allocated the given data.
+         */
+        PAX_NODISCARD bool free(void * data) override;
+
+        /**
+         * @return True iff the primary or the secondary allocator allocated the given data.
+         */
+        PAX_NODISCARD bool isMine(void * data) const override;
+
+        PAX_NODISCARD size_t getAllocationSize() const override;
+
+        /**
+         * @return The alignment guaranteed by both allocators.
+         */
+        PAX_NODISCARD size_t getAlignment() const override;
+
+        /**
+         * @return True iff both allocators are thread-safe.
+         */
+        PAX_NODISCARD bool isThreadSafe() const override;
+
+        /**
+         * @return The sum of the peaks of both allocators.
+         *         This is an upper bound of the peak number of objects allocated by this allocator.
+         */
+        PAX_NODISCARD size_t getPeakNumberOfAllocations() const override;
+
+        /**
+         * The statistics of both allocators are summed up.
+         * The hole ratio is that of the primary allocator.
+         * @return A snapshot of the memory usage of this allocator.
+         */
+        PAX_NODISCARD AllocatorStatistics getStatistics() const override;
+
+        /**
+         * @return The number of allocations that were served by the secondary allocator so far.
+         */
+        PAX_NODISCARD uint64_t getNumberOfSpills() const;
+
+        PAX_NODISCARD const std::shared_ptr<Allocator> & getPrimary() const;
+        PAX_NODISCARD const std::shared_ptr<Allocator> & getSecondary() const;
+
+        /**
+         * Creates an allocator factory for AllocationService::setDefaultAllocatorFactory
+         * that creates a PoolAllocator of the given maximum capacity for each type and spills over to a SlabAllocator.
+         * Only use it for types that are never iterated with a PropertyPool, as PropertyPool refuses ChainedAllocators.
+         * A PropertyPool that is created before the first object of its type is allocated registers a dedicated pool instead.
+         * @param maxCapacity The maximum number of objects that are allocated in the pool of each type.
+         * @return A factory creating ChainedAllocators.
+         */
+        PAX_NODISCARD static AllocationService::AllocatorFactory CreateFactory(PoolAllocator::Index maxCapacity);
+    };
+}
+
+#endif //POLYPROPYLENE_CHAINEDALLOCATOR_H
@@ -0,0 +1,181 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_CONCURRENTALLOCATOR_H
+#define POLYPROPYLENE_CONCURRENTALLOCATOR_H
+
+#include "../Allocator.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace PAX {
+    /**
+     * Makes any allocator safe to be used from multiple threads.
+     * Each thread that uses a ConcurrentAllocator gets its own magazine, a small cache of chunks
+     * that it can allocate from and free to without any synchronisation.
+     * When a magazine runs empty, it is refilled with a batch of chunks from the wrapped allocator
+     * (the backend) under a lock.
+     * When a magazine is full, freed chunks are handed back via a lock-free stack that is drained
+     * on the next refill of any thread.
+     * Thus, chunks may be freed from any thread, not only from the thread that allocated them.
+     *
+     * Beware that chunks cached in magazines are still allocated from the backend's point of view.
+     * Call flush() before inspecting the backend directly (e.g., when iterating a PoolAllocator).
+     * For the same reason, handles to objects in a backing PoolAllocator (@ref Handle) are only invalidated
+     * once the chunk of a freed object is given back to the pool (e.g., by flush()).
+     * Until then, such handles still resolve to the freed chunk, which may already hold a new object
+     * if the freeing thread allocated it again.
+     */
+    class ConcurrentAllocator : public Allocator {
+    public:
+        static constexpr size_t DefaultBatchSize = 32;
+
+        /**
+         * A counter that is only increased by a single thread but may be read by any thread.
+         * Increasing it does not need an atomic read-modify-write operation.
+         */
+        struct OwnedCounter {
+            std::atomic<uint64_t> value { 0 };
+
+            OwnedCounter & operator+=(uint64_t n) {
+                value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+                return *this;
+            }
+        };
+
+        /// The cache of chunks of a single thread.
+        struct Magazine {
+            std::vector<void*> chunks;
+            /// Chunks handed out and taken back by the owning thread (@ref getStatistics).
+            OwnedCounter allocations;
+            OwnedCounter frees;
+        };
+
+    private:
+        const std::shared_ptr<Allocator> backend;
+        const size_t batchSize;
+
+        /// Unique id of this allocator that is never reused, such that threads can safely cache their magazine.
+        const uint64_t id;
+
+        /// Guards backend.
+        mutable std::shared_mutex backendMutex;
+
+        /**
+         * Guards the list of magazines (but not the magazines themselves).
+         * Threads only keep weak references to their magazines, such that they notice when this allocator is destroyed.
+         */
+        mutable std::mutex magazinesMutex;
+        std::vector<std::shared_ptr<Magazine>> magazines;
+
+        /**
+         * The chunks that are currently handed out by this allocator.
+         * Only maintained in debug builds to detect frees of foreign or unallocated chunks (@ref free).
+         */
+        std::mutex handedOutMutex;
+        std::unordered_set<void*> handedOut;
+
+        /**
+         * Head of an intrusive singly-linked stack of freed chunks.
+         * The pointer to the next chunk is stored in the first bytes of each freed chunk.
+         */
+        std::atomic<void*> remoteFrees { nullptr };
+
+        /**
+         * @return The magazine of the calling thread. Creates it if it does not exist yet.
+         */
+        Magazine & localMagazine();
+
+        /**
+         * Refills the given magazine with remotely freed chunks and with chunks from the backend.
+         * Locks the backend.
+         */
+        void refill(Magazine & magazine);
+
+        /**
+         * Gives all chunks on the remote free stack back to the backend.
+         * Assumes backendMutex to be locked.
+         */
+        void drainRemoteFreesToBackend();
+
+    public:
+        /**
+         * Creates a ConcurrentAllocator that makes the given allocator thread-safe.
+         * The given allocator must not be used directly anymore afterwards.
+         * @param backend The allocator to obtain chunks from.
+         * @param batchSize The number of chunks a thread obtains from the backend at once.
+         */
+        explicit ConcurrentAllocator(const std::shared_ptr<Allocator> & backend, size_t batchSize = DefaultBatchSize);
+        ~ConcurrentAllocator() override;
+
+        /**
+         * Allocates a chunk from the magazine of the calling thread.
+         * Only locks when the magazine has to be refilled from the backend.
+         */
+        PAX_NODISCARD void * allocate() override;
+
+        /**
+         * Allocates the given number of chunks.
+         * Chunks are taken from the magazine of the calling thread first.
+         * The rest is allocated from the backend at once, locking it only once.
+         */
+        void allocateN(size_t count, void ** out) override;
+
+        /**
+         * Frees the given chunk to the magazine of the calling thread.
+         * Never locks, as long as the allocation size is at least sizeof(void*).
+         * The backend only notices the free once the chunk is given back to it (e.g., by flush()).
+         * In release builds, it is not checked whether the given data was allocated by this allocator.
+         * In debug builds, chunks that do not belong to the backend or that are not allocated are refused.
+         * @return True iff the chunk was freed. Always true in release builds.
+         */
+        PAX_NODISCARD bool free(void * data) override;
+
+        /**
+         * Asks the backend if the given data belongs to it.
+         * Takes a shared lock on the backend.
+         */
+        PAX_NODISCARD bool isMine(void * data) const override;
+        PAX_NODISCARD size_t getAllocationSize() const override;
+        PAX_NODISCARD size_t getAlignment() const override;
+
+        /**
+         * @return True.
+         */
+        PAX_NODISCARD bool isThreadSafe() const override;
+
+        /**
+         * @return The peak number of allocations of the backend.
+         *         This includes chunks that were cached by threads but not handed out.
+         */
+        PAX_NODISCARD size_t getPeakNumberOfAllocations() const override;
+
+        /**
+         * Sums up the allocations and frees of all threads.
+         * The live objects are the difference of both.
+         * Without PAX_WITH_ALLOCATOR_STATISTICS, the live objects, the peak, and the hole ratio are those of
+         * the backend, which includes chunks that were cached by threads but not handed out.
+         * @return A snapshot of the memory usage of this allocator.
+         */
+        PAX_NODISCARD AllocatorStatistics getStatistics() const override;
+
+        /**
+         * Gives all chunks cached in the magazines of all threads back to the backend.
+         * Afterwards, the backend only considers those chunks as allocated that are actually in use.
+         * Only call this while no other thread uses this allocator!
+         */
+        void flush();
+
+        /**
+         * @return The allocator that is made thread-safe by this ConcurrentAllocator.
+         */
+        PAX_NODISCARD const std::shared_ptr<Allocator> & getBackend() const;
+    };
+}
+
+#endif //POLYPROPYLENE_CONCURRENTALLOCATOR_H
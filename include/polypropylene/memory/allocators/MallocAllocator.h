@@ -11,18 +11,36 @@
 namespace PAX {
     /**
      * Allocator that simply uses malloc and free.
+     * Over-aligned objects (alignment greater than alignof(std::max_align_t)) are allocated with the aligned operator new instead.
+     * Each allocation is tracked in a hash set to answer isMine.
+     * Prefer SlabAllocator for allocating many objects without a capacity limit.
      */
     class MallocAllocator : public Allocator {
         const size_t elementSize;
+        const size_t alignment;
         std::unordered_set<void*> allocatedObjects;
+        size_t peakNumberOfAllocations = 0;
+        uint64_t totalAllocations = 0;
+        uint64_t totalFrees = 0;
+
+        PAX_NODISCARD bool isOverAligned() const;
 
     public:
-        MallocAllocator(const std::string & name, size_t elementSize);
+        /**
+         * @param name The name of this allocator used for debug messages.
+         * @param elementSize The size of each allocated object.
+         * @param alignment The alignment of each allocated object. Has to be a power of two.
+         *                  If 0, alignof(std::max_align_t) is used as guaranteed by malloc.
+         */
+        MallocAllocator(const std::string & name, size_t elementSize, size_t alignment = 0);
 
         PAX_NODISCARD void* allocate() override;
         PAX_NODISCARD bool free(void * data) override;
         PAX_NODISCARD size_t getAllocationSize() const override;
+        PAX_NODISCARD size_t getAlignment() const override;
         PAX_NODISCARD bool isMine(void * data) const override;
+        PAX_NODISCARD size_t getPeakNumberOfAllocations() const override;
+        PAX_NODISCARD AllocatorStatistics getStatistics() const override;
     };
 }
 
@@ -7,107 +7,229 @@
 
 #include "../Allocator.h"
 #include <polypropylene/log/Errors.h>
-#include <cstring>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
 
 namespace PAX {
     /**
-     * A PoolAllocator of fixed capacity.
-     * It can neither grow nor shrink.
+     * A PoolAllocator that grows in pages of fixed capacity.
+     * When all chunks are in use, a new page is added on demand.
+     * Pages are never moved, so allocated chunks stay valid until they are freed.
+     * Empty pages at the end of the pool can be released with shrink().
+     * Chunks are indexed consecutively across all pages.
+     * Pages are obtained from PageMemory, so on POSIX systems large pages are mapped from the operating
+     * system and physical memory is committed only for the chunks that are actually touched.
      */
     class PoolAllocator : public Allocator {
     public:
         using Index = int32_t;
 
+        /// Counts how often a chunk was freed. Used to detect stale references (@ref Handle).
+        using Generation = uint32_t;
+
         /**
-         * Metadata for each allocatable element.
+         * Moves the object at 'from' to the uninitialised chunk 'to' (@ref compact).
+         * Afterwards, 'from' is freed by the pool, so the object at 'from' has to be destroyed.
          */
-        struct ChunkInfo {
-        public:
-            bool allocated;
-        };
+        using Relocator = std::function<void(void * from, void * to)>;
+
+        /// The maximum capacity of a PoolAllocator if not specified otherwise.
+        static constexpr Index UnlimitedCapacity = std::numeric_limits<Index>::max();
 
     private:
         static size_t DefaultCapacity; // = 1024
 
         /// Chunk data
         using memunit = char;
-        static constexpr size_t MetaDataSize = sizeof(ChunkInfo);
 
         /**
-         * This is a stack to remember which chunks of memory are free.
-         * The stack is realised as an array where the top is at the beginning and is moved to the back as elements get popped.
-         * Hence, when an element is pushed, topIndex is decremented.
+         * This is a set to remember which chunks of memory are free.
+         * It is the only place where we store if a chunk is allocated
+         * so that the chunks themselves contain user data only.
+         * It is realised as a two-level bitmap:
+         * Bit i in 'words' is set iff the chunk at index i is free.
+         * Bit w in 'summary' is set iff words[w] contains at least one free chunk.
+         * Thus, freeing a chunk (push) takes constant time and finding the free chunk with the
+         * smallest index (pop) only has to inspect a few words.
+         * Reusing the smallest free index first keeps allocated chunks dense at the front of the pool.
+         * Each word is stamped with the epoch in which it was written last.
+         * Words from an older epoch are considered to contain free chunks only, such that
+         * clearing the set only has to reset the summary instead of all words.
          */
-        struct IndexStack {
+        struct FreeChunkSet {
+        public:
+            using Word = uint64_t;
+            using Epoch = uint64_t;
+            static constexpr Index BitsPerWord = 64;
+
         private:
-            const Index capacity;
-            Index * stack;
-            Index topIndex;
+            Index capacity = 0;
+            Index size = 0;
+            std::vector<Word> words;
+            std::vector<Word> summary;
+
+            /// words[w] is only up to date if wordEpochs[w] == epoch.
+            std::vector<Epoch> wordEpochs;
+            Epoch epoch = 0;
+
+            /// All words in 'summary' before this index are zero.
+            size_t firstNonEmptySummaryWord = 0;
+
+            /**
+             * @return The word w with all bits set whose chunks are within capacity.
+             */
+            PAX_NODISCARD Word allFree(size_t w) const;
+
+            /**
+             * @return The word w, which contains free chunks only if it is outdated.
+             */
+            PAX_NODISCARD Word word(size_t w) const;
+
+            /**
+             * Brings the word w up to date such that it can be modified.
+             * @return A reference to the word w.
+             */
+            Word & touch(size_t w);
+
+            /**
+             * Sets all bits in 'summary' that belong to words within capacity.
+             */
+            void fillSummary();
 
         public:
-            IndexStack(Index capacity);
-            IndexStack(IndexStack && other) noexcept;
-            ~IndexStack();
-
             Index pop();
-            void push(Index val);
+
+            /**
+             * Pops the given number of free indices in ascending order and passes each to the given consumer.
+             * Whole words of free chunks are claimed at once.
+             * Assumes that there are at least count free indices.
+             */
+            template<typename Consumer>
+            void popN(Index count, Consumer && consume);
+
+            void push(Index i);
+
+            /**
+             * Marks all indices as free.
+             * Only the summary is reset. All words are outdated by starting a new epoch.
+             */
             void clear();
 
-            bool empty() const;
-            bool full() const;
+            /**
+             * Changes the capacity of this set to the given value.
+             * When growing, all new indices in [capacity, newCapacity) are free.
+             * When shrinking, all indices in [newCapacity, capacity) are dropped.
+             */
+            void resize(Index newCapacity);
+
+            PAX_NODISCARD bool contains(Index i) const;
+            PAX_NODISCARD bool empty() const;
+            PAX_NODISCARD Index getSize() const;
+
+            /**
+             * @return The smallest index in [from, capacity) that is not free.
+             *         Returns capacity if there is no such index.
+             */
+            PAX_NODISCARD Index nextNotContained(Index from) const;
+
+            /**
+             * @return The greatest index in [0, from] that is not free.
+             *         Returns -1 if there is no such index.
+             */
+            PAX_NODISCARD Index previousNotContained(Index from) const;
         } freeChunks;
 
         /// Memory
-        const Index capacity;
         const size_t elementSize;
-        Index firstElement = 0;
-        Index lastElement = -1;
+        const size_t alignment;
+        const Index pageCapacity;
+        const Index maxCapacity;
 
         /**
-         * The memory where everything is stored.
-         * This is a sequence of imaginary chunks where each chunk
-         * consists of some metadata i followed by user data:
+         * Bounds of the allocated chunks.
+         * All allocated chunks are always located in [firstElement, lastElement].
+         * The bounds are only tightened lazily when they are requested via begin() or end().
+         * This avoids searching for the next allocated chunk upon each call to free.
+         */
+        mutable Index firstElement = 0;
+        mutable Index lastElement = -1;
+        mutable bool boundsAreTight = true;
+
+        /**
+         * The pages where everything is stored.
+         * Each page is a sequence of imaginary chunks of user data:
          *
-         *     --------------------------------------------
-         * <-- | i | userdata | i | userdata | i | userdata -->
-         *     --------------------------------------------
+         *     ----------------------------------------
+         * <-- | userdata | userdata | userdata | ... -->
+         *     ----------------------------------------
          *
-         * The metadata i is of size 'MetaDataSize' and is defined by the type ChunkInfo.
-         * The userdata is of size 'elementSize'.
+         * Each chunk is of size 'ChunkSize()', which is 'elementSize' rounded up to
+         * a multiple of 'alignment'.
+         * As each page is aligned to 'alignment', so is each chunk.
+         * Each page holds 'pageCapacity' chunks.
+         * The chunk at index i is located in page (i / pageCapacity).
+         */
+        std::vector<memunit*> pages;
+
+        /// Indices into 'pages' sorted by the address of the page for fast lookup of pointers.
+        std::vector<Index> pagesByAddress;
+
+        /**
+         * The generation of each chunk by index.
+         * The generation of a chunk is increased each time it is freed.
+         * This vector never shrinks, such that generations of released pages are not reset.
+         * Otherwise, stale handles could become valid again when pages are added again.
          */
-        memunit * memory = nullptr;
+        std::vector<Generation> generations;
+
+        /**
+         * Is increased each time all chunks are freed at once (@ref freeAll).
+         * It is added to the generation of each chunk, such that freeAll does not have to touch any chunk.
+         */
+        Generation epoch = 0;
+
         int32_t numberOfAllocations = 0;
+        int32_t peakNumberOfAllocations = 0;
+        uint64_t totalAllocations = 0;
+        uint64_t totalFrees = 0;
+
+        /// Whether the operating system should back pages with huge pages (@ref setHugePages).
+        bool hugePages = false;
 
         PAX_NODISCARD size_t ChunkSize() const;
-        PAX_NODISCARD size_t MemorySize() const;
+        PAX_NODISCARD size_t PageSize() const;
 
         /**
-         * @return The user data that is associated to the given metadata.
+         * @return The index of the page the given pointer points into.
+         *         Returns -1 if the given pointer does not point into any page of this pool.
          */
-        PAX_NODISCARD static void * DataOf(ChunkInfo * chunk);
+        PAX_NODISCARD Index pageOf(const void * data) const;
 
         /**
-         * @return A pointer into 'memory' to the beginning of this data's chunk
-         * (w.r.t. to its prefixing ChunkInfo).
+         * Adds a new page to the end of this pool.
+         * @return False, if adding the page would exceed the maximum capacity of this pool.
          */
-        PAX_NODISCARD static memunit * FromData(void * data);
+        bool addPage();
 
         /**
-         * Assumes that the given pointer points to the begin of a data chunk in 'memory'
-         * (i.e., (chunk - memory) % ChunkSize() == 0).
-         * @return The metadata for the data chunk at the given pointer into 'memory'.
+         * Removes the last page of this pool.
+         * Assumes that no chunk in that page is allocated.
          */
-        PAX_NODISCARD ChunkInfo* InfoFor(memunit * chunk) const;
+        void removeLastPage();
 
         /**
-         * Assumes that the given pointer points to the begin of a data chunk in 'memory'
-         * (i.e., (chunk - memory) % ChunkSize() == 0).
-         * @return The index of the data chunk at the given pointer into 'memory'.
+         * Assumes that the given pointer points to the begin of a data chunk in a page
+         * (i.e., (chunk - page) % ChunkSize() == 0).
+         * @return The index of the data chunk at the given pointer into a page.
          */
         PAX_NODISCARD Index indexOf(const memunit * m) const;
 
         /**
-         * @return A pointer to the data chunk inside 'memory' at the given index.
+         * @return A pointer to the data chunk inside a page at the given index.
          */
         PAX_NODISCARD memunit* memAtIndex(Index index) const;
 
@@ -121,19 +243,30 @@ namespace PAX {
         /**
          * Updates the bounds assuming the element at index i was just deleted.
          * In particular, checks whether i was the first or the last element and
-         * updates the bounds accordingly.
+         * marks the bounds to be tightened on their next request.
          * @param i Index of the element that was just deleted.
          */
         void updateBoundsAfterDeletionOf(Index i);
 
+        /**
+         * Moves the bounds to the first and last allocated chunk.
+         */
+        void tightenBounds() const;
+
     public:
         /**
-         * Creates a PoolAllocator of a fixed capacity.
+         * Creates a PoolAllocator that grows in pages of the given capacity.
+         * The first page is allocated right away.
          * @param name The name of this allocator used for debug messages.
          * @param elementSize The size each allocated data object should have.
-         * @param capacity The maximum number of elements that can be allocated simultaneously.
+         * @param pageCapacity The number of elements each page can hold.
+         * @param maxCapacity The maximum number of elements that can be allocated simultaneously.
+         *                    The pool will not grow beyond the number of pages necessary to hold that many elements.
+         * @param alignment The alignment of each allocated data object. Has to be a power of two.
+         *                  If 0, the greatest power of two dividing elementSize (but at most alignof(std::max_align_t))
+         *                  is chosen, which suffices for any type of size elementSize.
          */
-        PoolAllocator(const std::string & name, size_t elementSize, Index capacity = DefaultCapacity);
+        PoolAllocator(const std::string & name, size_t elementSize, Index pageCapacity = DefaultCapacity, Index maxCapacity = UnlimitedCapacity, size_t alignment = 0);
         PoolAllocator(PAX::PoolAllocator && other) noexcept;
 
         PoolAllocator(const PoolAllocator & other) = delete;
@@ -144,7 +277,8 @@ namespace PAX {
         /**
          * Allocates a new chunk of data in the pool and returns it.
          * This reduces the available chunks to allocate by 1.
-         * If already n chunks are allocated where n is the capacity of this PoolAllocator,
+         * If all chunks are allocated, a new page will be added to this pool.
+         * If the pool cannot grow anymore because it reached its maximum capacity,
          * a runtime_error with message "memory overflow" will be thrown.
          * The caller will get ownership of the returned memory chunk.
          * The memory can be given back to the PoolAllocator with the free method.
@@ -153,6 +287,18 @@ namespace PAX {
          */
         PAX_NODISCARD void * allocate() override;
 
+        /**
+         * Allocates the given number of chunks at once.
+         * The pool grows at most once to fit all chunks.
+         * Free chunks are claimed from the allocation bitmap a word at a time, so that chunks of
+         * contiguous free runs are handed out in ascending order of their address.
+         * If the pool cannot hold the given number of additional chunks because of its maximum capacity,
+         * a runtime_error with message "memory overflow" is thrown and nothing is allocated.
+         * @param count The number of chunks to allocate.
+         * @param out Array of at least count elements to which the allocated chunks are written.
+         */
+        void allocateN(size_t count, void ** out) override;
+
         /**
          * Gives ownership of the given memory back to this PoolAllocator.
          * The memory is not altered right away but available for reallocation
@@ -186,22 +332,99 @@ namespace PAX {
         /**
          * Clears the contents of this PoolAllocator and resets it,
          * such as if it would just have been created.
+         * All pages except for the first one are released.
          * @return True iff clearing was successful.
          *         False iff there are still allocated elements that have to be freed first.
          */
         PAX_NODISCARD bool clear();
 
         /**
-         * Returns metadata for the data at the given index.
-         * @param index The index of which metadata should be given.
-         * @return A pointer to the metadata about the element at the given index.
+         * Frees all allocated chunks at once without touching them.
+         * Like free, this does not call any destructors.
+         * In contrast to clear, pages are kept and all handles to allocated chunks are invalidated.
+         * Neither the chunk generations nor the allocation bitmap are walked, as both are invalidated by starting a new epoch.
+         */
+        void freeAll();
+
+        /**
+         * Adds pages until this pool can hold the given number of elements without growing.
+         * Does not grow beyond the maximum capacity.
+         * @param capacity The number of elements this pool should be able to hold.
+         */
+        PAX_MAYBEUNUSED void reserve(Index capacity);
+
+        /**
+         * Releases all empty pages at the end of this pool.
+         * The first page is always kept.
+         * If the pages are mapped from the operating system (@ref PageMemory), the physical memory
+         * behind the free chunks at the end of the last remaining page is returned to the operating system, too.
+         * Allocated chunks are never moved by this operation.
+         * @return The number of pages that were released.
+         */
+        PAX_MAYBEUNUSED size_t shrink();
+
+        /**
+         * Moves allocated chunks from the back of this pool to the free chunks with the lowest indices,
+         * such that iterating the pool does not have to step over holes anymore.
+         * The last allocated chunk is moved first.
+         * Compaction is incremental: It stops when the given time budget is exceeded and can be resumed
+         * by calling compact again later.
+         * The pool does not know the type of its objects, so the given relocator has to move each object.
+         * It is responsible for updating all references to the moved object.
+         * Handles to moved objects become invalid.
+         * Pages are not released. Use shrink() after compaction for that.
+         * @param relocate Moves an object from its chunk to a free chunk.
+         * @param budget The time after which no further objects are moved.
+         *               At least one object is moved if the pool is not compact.
+         * @return The number of objects that were moved.
+         */
+        PAX_MAYBEUNUSED size_t compact(const Relocator & relocate, std::chrono::nanoseconds budget = std::chrono::nanoseconds::max());
+
+        /**
+         * @return True iff there are no free chunks in front of any allocated chunk
+         *         (i.e., all allocated chunks are located in [0, getNumberOfAllocations())).
+         */
+        PAX_NODISCARD bool isCompact() const;
+
+        /**
+         * @param index The index of the chunk to check.
+         * @return True iff the chunk at the given index is currently allocated.
          */
-        PAX_NODISCARD ChunkInfo * getChunkInfo(Index index) const;
+        PAX_NODISCARD bool isAllocated(Index index) const;
+
+        /**
+         * Finds the next allocated chunk without inspecting the chunks themselves.
+         * Skips up to 64 free chunks at once.
+         * @param from The index to start searching at.
+         * @return The smallest index i >= from of an allocated chunk.
+         *         Returns end() if there is no such chunk.
+         */
+        PAX_NODISCARD Index nextAllocated(Index from) const;
+
+        /**
+         * @param data Pointer to the beginning of a chunk of this pool.
+         * @return The index of the chunk the given pointer points to.
+         *         Returns -1 if the given pointer does not point into this pool.
+         */
+        PAX_NODISCARD Index getIndexOf(const void * data) const;
+
+        /**
+         * Returns the generation of the chunk at the given index.
+         * The generation changes whenever the chunk is freed, including by freeAll.
+         * Thus, an object allocated at the given index is still alive iff the generation
+         * did not change since it was allocated.
+         * This is inlined as it is the only cost of resolving a Handle.
+         * @param index The index of the chunk.
+         * @return The current generation of the chunk at the given index.
+         */
+        PAX_NODISCARD Generation getGeneration(Index index) const {
+            return generations[size_t(index)] + epoch;
+        }
 
         /**
          * Returns the data at the given index.
          * This data may be unused (not allocated) or allocated.
-         * To find out, call getChunkInfo for the same index.
+         * To find out, call isAllocated for the same index.
          * @param index The index whose data should be given.
          * @return A pointer to the data at the given index.
          *         The returned pointer will be of the size returned by 'getAllocationSize()'.
@@ -217,10 +440,73 @@ namespace PAX {
         PAX_NODISCARD size_t getAllocationSize() const override;
 
         /**
-         * @return The maximum number of elements that can be allocated simultaneously.
+         * @return The alignment of each allocated data object.
+         */
+        PAX_NODISCARD size_t getAlignment() const override;
+
+        /**
+         * @return The number of elements that can be allocated simultaneously without adding new pages.
+         *         All indices in [0, getCapacity()) are valid chunk indices.
          */
         PAX_NODISCARD Index getCapacity() const;
 
+        /**
+         * @return The number of elements each page can hold.
+         */
+        PAX_NODISCARD Index getPageCapacity() const;
+
+        /**
+         * @return The number of pages currently allocated by this pool.
+         */
+        PAX_NODISCARD size_t getNumberOfPages() const;
+
+        /**
+         * Does not modify this pool, such that statistics can be queried concurrently with other readers.
+         * @return A snapshot of the memory usage of this pool.
+         */
+        PAX_NODISCARD AllocatorStatistics getStatistics() const override;
+
+        /**
+         * Advises the operating system to back the pages of this pool with huge pages (e.g., 2MiB on x86-64).
+         * This reduces TLB misses when iterating big pools but wastes memory for small ones,
+         * so only enable this for pools whose pages span several megabytes.
+         * Only has an effect on pages that are mapped from the operating system (@ref PageMemory).
+         * Applies to current pages and all pages that are added later.
+         * @param enabled Whether huge pages should be used.
+         */
+        PAX_MAYBEUNUSED void setHugePages(bool enabled);
+
+        /**
+         * @return True iff this pool advises the operating system to use huge pages (@ref setHugePages).
+         */
+        PAX_NODISCARD bool usesHugePages() const;
+
+        /**
+         * @return The maximum number of elements this pool can grow to.
+         */
+        PAX_NODISCARD Index getMaxCapacity() const;
+
+        /**
+         * @return The number of chunks that can still be allocated, including those of pages that can still be added
+         *         without exceeding the maximum capacity.
+         */
+        PAX_NODISCARD size_t getRemainingCapacity() const;
+
+        /**
+         * @return True iff allocate() would throw because this pool reached its maximum capacity.
+         */
+        PAX_NODISCARD bool isFull() const;
+
+        /**
+         * @return The number of chunks that are currently allocated.
+         */
+        PAX_NODISCARD Index getNumberOfAllocations() const;
+
+        /**
+         * @return The maximum number of chunks that were allocated simultaneously since this pool was created.
+         */
+        PAX_NODISCARD size_t getPeakNumberOfAllocations() const override;
+
         /**
          * Points to the first allocated element in this PoolAllocator.
          * @return Index of the first allocated element.
@@ -236,10 +522,10 @@ namespace PAX {
         PAX_NODISCARD Index end() const;
 
         /**
-         * Sets the default capacity of new PoolAllocators to the given value.
+         * Sets the default page capacity of new PoolAllocators to the given value.
          * The default capacity is used when constructing new PoolAllocators without
-         * specifying a capacity explicitly.
-         * A pool allocator's capacity denotes the maximum number of elements it can contain.
+         * specifying a page capacity explicitly.
+         * A pool allocator's page capacity denotes the number of elements each of its pages can contain.
          * Does not affect existing pool allocators.
          * @param defaultCapacity
          */
@@ -0,0 +1,111 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_SIZECLASSALLOCATOR_H
+#define POLYPROPYLENE_SIZECLASSALLOCATOR_H
+
+#include "../AllocationService.h"
+#include "PoolAllocator.h"
+#include <atomic>
+
+namespace PAX {
+    /**
+     * Allocates objects of a single type from a pool that is shared by all types of the same size class.
+     * Size classes are powers of two, starting at MinimumSizeClass bytes.
+     * Compared to one pool per type, this reduces the memory reserved for types with few instances
+     * and keeps objects of small types close together in memory.
+     * Objects are freed to the shared pool by their address.
+     *
+     * Use CreateFactory() to let an AllocationService create SizeClassAllocators by default.
+     */
+    class SizeClassAllocator : public Allocator {
+        const size_t elementSize;
+        const std::shared_ptr<Allocator> sizeClass;
+
+        /// Counts the objects of this allocator's type only. Atomic, as the size class might be thread-safe.
+        std::atomic<size_t> numberOfAllocations { 0 };
+        std::atomic<size_t> peakNumberOfAllocations { 0 };
+        std::atomic<uint64_t> totalAllocations { 0 };
+        std::atomic<uint64_t> totalFrees { 0 };
+
+        void countAllocations(size_t count);
+
+    public:
+        static constexpr size_t MinimumSizeClass = 16;
+
+        /**
+         * Creates an allocator for objects of the given size that allocates from the given shared allocator.
+         * @param name The name of this allocator used for debug messages.
+         * @param elementSize The size of each allocated object.
+         * @param sizeClass The allocator shared by all types of the same size class.
+         *                  Its allocation size has to be at least elementSize.
+         */
+        SizeClassAllocator(const std::string & name, size_t elementSize, const std::shared_ptr<Allocator> & sizeClass);
+
+        PAX_NODISCARD void * allocate() override;
+        PAX_NODISCARD bool free(void * data) override;
+        void allocateN(size_t count, void ** out) override;
+        PAX_NODISCARD size_t freeN(void * const * data, size_t count) override;
+
+        /**
+         * @return True iff the given data belongs to the shared allocator of this size class.
+         *         Hence, this also returns true for objects of other types of the same size class.
+         */
+        PAX_NODISCARD bool isMine(void * data) const override;
+
+        /**
+         * @return The size of the objects of the type this allocator was created for.
+         */
+        PAX_NODISCARD size_t getAllocationSize() const override;
+
+        /**
+         * @return The alignment of the shared allocator of this size class.
+         */
+        PAX_NODISCARD size_t getAlignment() const override;
+
+        /**
+         * @return True iff the shared allocator of this size class is thread-safe.
+         */
+        PAX_NODISCARD bool isThreadSafe() const override;
+
+        /**
+         * @return The peak number of objects of the type this allocator was created for.
+         */
+        PAX_NODISCARD size_t getPeakNumberOfAllocations() const override;
+
+        /**
+         * The objects are counted for the type this allocator was created for only.
+         * The reserved bytes and the hole ratio are those of the shared allocator of this size class.
+         * @return A snapshot of the memory usage of this allocator.
+         */
+        PAX_NODISCARD AllocatorStatistics getStatistics() const override;
+
+        /**
+         * @return The allocator shared by all types of this size class.
+         */
+        PAX_NODISCARD const std::shared_ptr<Allocator> & getSizeClass() const;
+
+        /**
+         * @return The smallest size class that can hold objects of the given size.
+         */
+        PAX_NODISCARD static size_t SizeClassOf(size_t elementSize);
+
+        /**
+         * Creates an allocator factory for AllocationService::setDefaultAllocatorFactory that shares
+         * PoolAllocators across all types of the same size class.
+         * The pools are owned by the created factory, so use each factory for a single AllocationService only.
+         * Only use it for types that are never iterated with a PropertyPool, as PropertyPool refuses shared pools.
+         * A PropertyPool that is created before the first object of its type is allocated registers a dedicated pool instead.
+         * @param threadSafe Set this to true if the AllocationService is thread-safe (@ref AllocationService::setThreadSafe).
+         *                   Each shared pool is then wrapped into a ConcurrentAllocator.
+         *                   A thread-safe AllocationService throws a runtime error when this factory creates an
+         *                   allocator without it, as it cannot guard pools that are shared across types.
+         * @param pageCapacity The page capacity of the shared pools.
+         * @return A factory creating SizeClassAllocators.
+         */
+        PAX_NODISCARD static AllocationService::AllocatorFactory CreateFactory(bool threadSafe = false, PoolAllocator::Index pageCapacity = PoolAllocator::Index(PoolAllocator::GetDefaultCapacity()));
+    };
+}
+
+#endif //POLYPROPYLENE_SIZECLASSALLOCATOR_H
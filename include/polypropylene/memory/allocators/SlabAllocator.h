@@ -0,0 +1,98 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_SLABALLOCATOR_H
+#define POLYPROPYLENE_SLABALLOCATOR_H
+
+#include "../Allocator.h"
+#include <vector>
+
+namespace PAX {
+    /**
+     * Allocator for objects of fixed size without any capacity limit, as a faster alternative to MallocAllocator.
+     * Objects are carved out of large slabs whose size doubles with each new slab up to MaxSlabSize.
+     * Freed objects are linked into an intrusive free list and reused first (most recently freed first).
+     * Hence, allocate and free take constant time, except when a new slab has to be obtained.
+     * isMine looks up the slab containing the given pointer in a table of slabs sorted by address.
+     * As slabs grow geometrically, this table stays small.
+     *
+     * In contrast to a PoolAllocator, a SlabAllocator does not know which of its chunks are allocated.
+     * Thus, it cannot be iterated, does not support handles, and cannot detect double frees.
+     * Slabs are only released when the allocator is destroyed.
+     */
+    class SlabAllocator : public Allocator {
+        struct Slab {
+            char * memory;
+            size_t size;
+        };
+
+        const size_t elementSize;
+        /// The alignment of each chunk. At least that of pointers.
+        const size_t alignment;
+        const size_t chunkSize;
+
+        /// All slabs sorted by address.
+        std::vector<Slab> slabs;
+        size_t nextSlabSize;
+
+        /// Head of the list of freed chunks. Each freed chunk stores a pointer to the next one in its first bytes.
+        void * freeList = nullptr;
+
+        /// The part of the newest slab that was not handed out yet.
+        char * unused = nullptr;
+        char * unusedEnd = nullptr;
+
+        size_t numberOfAllocations = 0;
+        size_t peakNumberOfAllocations = 0;
+        uint64_t totalAllocations = 0;
+        uint64_t totalFrees = 0;
+
+        /**
+         * Obtains a new slab and makes it the unused memory.
+         */
+        void addSlab();
+
+        /**
+         * @return The slab containing the given pointer or nullptr if there is none.
+         */
+        PAX_NODISCARD const Slab * slabOf(const void * data) const;
+
+    public:
+        static constexpr size_t MinSlabSize = 16 * 1024;
+        static constexpr size_t MaxSlabSize = 16 * 1024 * 1024;
+
+        /**
+         * @param name The name of this allocator used for debug messages.
+         * @param elementSize The size of each allocated object.
+         * @param alignment The alignment of each allocated object. Has to be a power of two.
+         *                  If 0, the greatest power of two dividing elementSize (but at most alignof(std::max_align_t))
+         *                  is chosen, like for PoolAllocators.
+         */
+        SlabAllocator(const std::string & name, size_t elementSize, size_t alignment = 0);
+        SlabAllocator(const SlabAllocator & other) = delete;
+        SlabAllocator & operator=(const SlabAllocator & other) = delete;
+        ~SlabAllocator() override;
+
+        PAX_NODISCARD void * allocate() override;
+
+        /**
+         * Links the given chunk into the free list.
+         * @return False iff the given data does not point to the beginning of a chunk of this allocator.
+         */
+        PAX_NODISCARD bool free(void * data) override;
+
+        PAX_NODISCARD bool isMine(void * data) const override;
+        PAX_NODISCARD size_t getAllocationSize() const override;
+        PAX_NODISCARD size_t getAlignment() const override;
+        PAX_NODISCARD size_t getPeakNumberOfAllocations() const override;
+        PAX_NODISCARD AllocatorStatistics getStatistics() const override;
+
+        /**
+         * @return The number of slabs obtained so far.
+         */
+        PAX_NODISCARD size_t getNumberOfSlabs() const;
+    };
+}
+
+#endif //POLYPROPYLENE_SLABALLOCATOR_H
@@ -8,6 +8,7 @@
 #include <type_traits> // std::enable_if
 #include "polypropylene/definitions/Definitions.h"
 #include "polypropylene/reflection/Polymorphic.h"
+#include "polypropylene/memory/Handle.h"
 
 /**
  * Convenience macro for creating properties and entities with the allocation service.
@@ -17,12 +18,14 @@
  * @see pax_delete
  */
 #define pax_new(propOrEntityType) \
-    new (propOrEntityType::EntityType::GetAllocationService().allocate(paxtypeof(propOrEntityType))) propOrEntityType
+    new (propOrEntityType::EntityType::GetAllocationService().template allocate<propOrEntityType>()) propOrEntityType
 
 /**
  * Convenience function for easy deletion of properties and entities that were
  * allocated with the AllocationService (e.g., with pax_new).
  * This is a shortcut to invoking AllocationService::deleteAndFree<T>.
+ * Entities and properties are deleted with the service they were allocated with (e.g., @ref Entity::getAllocationService),
+ * regardless of the service bound at that time.
  * @tparam T The type on which the destructor for t should be called.
  *           Has to implement the Polymorphic interface.
  * @param t Pointer to the object that should be deleted.
@@ -35,9 +38,31 @@ template <class T>
 typename std::enable_if<std::is_base_of<::PAX::Polymorphic, T>::value, bool>::type
 pax_delete(T * t) {
     if (t != nullptr) {
-        return T::EntityType::GetAllocationService().template deleteAndFree<T>(t, t->getClassType().type.id);
+        return t->getAllocationService().template deleteAndFree<T>(t, t->getClassType().type.id);
     }
     return false;
 }
 
+/**
+ * Convenience function for creating a handle to a property or entity that was
+ * allocated with the AllocationService (e.g., with pax_new).
+ * In contrast to a raw pointer, the handle notices when the object was deleted.
+ * This is a shortcut to invoking AllocationService::getHandle<T>.
+ * Like pax_delete, this uses the service the object was allocated with.
+ * @tparam T The type of the referenced object.
+ *           Has to implement the Polymorphic interface.
+ * @param t Pointer to the object to create a handle for.
+ * @return A handle to the given object.
+ *         Returns an invalid handle if t is nullptr or was not allocated in a pool of the AllocationService.
+ * @see pax_new, AllocationService::getHandle<T>
+ */
+template <class T>
+typename std::enable_if<std::is_base_of<::PAX::Polymorphic, T>::value, ::PAX::Handle<T>>::type
+pax_handle(T * t) {
+    if (t != nullptr) {
+        return t->getAllocationService().template getHandle<T>(t, t->getClassType().type.id);
+    }
+    return ::PAX::Handle<T>();
+}
+
 #endif //POLYPROPYLENE_CREATION_H
@@ -5,6 +5,7 @@
 #ifndef POLYPROPYLENE_ENTITY_H
 #define POLYPROPYLENE_ENTITY_H
 
+#include <algorithm>
 #include <cassert>
 #include <vector>
 #include <optional>
@@ -14,7 +15,8 @@
 #include "../definitions/CompilerDetection.h"
 #include "../memory/AllocationService.h"
 #include "../reflection/TypeMap.h"
-#include "../event/EventService.h"
+#include "../event/LocalEventService.h"
+#include "PropertySignature.h"
 
 // We have to create this workaround, because MSVC can't handle constexpr functions in enable_if.
 #ifdef PAX_COMPILER_MSVC
@@ -33,6 +35,29 @@
 #define PAX_RETURN_EMPTYVEC_OF(type) return *reinterpret_cast<const std::vector<type*>*>(&GetEmptyPropertyVector())
 
 namespace PAX {
+    /**
+     * Binds an AllocationService to the entity type EntityType for the current thread while this scope is alive.
+     * Within the scope, pax_new, pax_delete, and PropertyPools of EntityType and its properties use the bound service
+     * instead of the default one (@ref Entity::GetAllocationService).
+     * This allows multiple isolated worlds (e.g., one per EntityManager) with their own pools that can be torn
+     * down independently and that can be simulated on separate threads without contention.
+     * Scopes can be nested. The previous binding is restored when a scope ends.
+     * @tparam EntityType The entity type for which the service should be bound.
+     */
+    template<typename EntityType>
+    class AllocationServiceScope {
+        AllocationService * previous;
+
+    public:
+        explicit AllocationServiceScope(AllocationService & service) : previous(EntityType::BindAllocationService(&service)) {}
+        AllocationServiceScope(const AllocationServiceScope & other) = delete;
+        AllocationServiceScope & operator=(const AllocationServiceScope & other) = delete;
+
+        ~AllocationServiceScope() {
+            EntityType::BindAllocationService(previous);
+        }
+    };
+
     /**
      * An Entity is a generic container for Properties.
      * @tparam TDerived The class deriving from Entity.
@@ -50,10 +75,16 @@ namespace PAX {
             return emptyvec;
         }
 
-        EventService localEventService;
+        /// Allocates an EventService only once a listener is added to this entity.
+        LocalEventService localEventService;
+
+        /// The service this entity was allocated with. Its properties are deleted with it.
+        AllocationService * allocationService = &GetAllocationService();
 
         TypeMap<TRootProperty*> singleProperties;
         TypeMap<std::vector<TRootProperty*>> multipleProperties;
+        /// The property types this entity contains. Mirrors the keys of singleProperties and multipleProperties.
+        PropertySignature signature;
 
     public:
         using EntityType = TDerived;
@@ -64,8 +95,15 @@ namespace PAX {
         /**
          * Deletes all properties that were allocated with the AllocationService
          * of this Entity (e.g., those that were allocated with pax_new).
+         * Properties are not deleted if the whole AllocationService is destroyed (@ref AllocationService::destroyAll)
+         * as it destroys the properties itself.
          */
         virtual ~Entity() {
+            if (allocationService->isDestroyingAll()) {
+                return;
+            }
+
+            AllocationServiceScope<TDerived> scope(*allocationService);
             const std::vector<TRootProperty*> & props = getAllProperties();
             for (TRootProperty * propToDelete : props) {
                 pax_delete(propToDelete);
@@ -73,6 +111,11 @@ namespace PAX {
         }
 
     private:
+        static AllocationService *& BoundAllocationService() {
+            static thread_local AllocationService * bound = nullptr;
+            return bound;
+        }
+
         bool isValid(Property<TDerived> * property) {
             if (property->owner) {
                 return false;
@@ -100,16 +143,48 @@ namespace PAX {
     public:
         /**
          * @return The AllocationService that is used for entity and property (de-) allocation for derived entitiy type TDerived.
+         *         This is the service bound on the current thread (@ref AllocationServiceScope) or the default service
+         *         if there is none.
          */
         PAX_NODISCARD static AllocationService& GetAllocationService() {
+            AllocationService * bound = BoundAllocationService();
+            return bound ? *bound : GetDefaultAllocationService();
+        }
+
+        /**
+         * @return The AllocationService that is used when no other service is bound on the current thread.
+         */
+        PAX_NODISCARD static AllocationService& GetDefaultAllocationService() {
             static AllocationService allocator;
             return allocator;
         }
 
+        /**
+         * Binds the given service for the current thread.
+         * Prefer AllocationServiceScope that restores the previous binding automatically.
+         * @param service The service to bind. If nullptr, the default service is used again.
+         * @return The previously bound service. nullptr if the default service was used.
+         */
+        static AllocationService * BindAllocationService(AllocationService * service) {
+            AllocationService * previous = BoundAllocationService();
+            BoundAllocationService() = service;
+            return previous;
+        }
+
+        /**
+         * @return The AllocationService that was in use when this entity was created.
+         *         Properties of this entity are deleted with this service on destruction.
+         */
+        PAX_NODISCARD AllocationService& getAllocationService() const {
+            return *allocationService;
+        }
+
         /**
          * @return The internal EventService of this Entity that is used for internal communication between properties.
+         *         Until a listener is added, it forwards all events to the EventService of the EntityManager
+         *         this entity was added to.
          */
-        PAX_NODISCARD EventService& getEventService() {
+        PAX_NODISCARD LocalEventService& getEventService() {
             return localEventService;
         }
 
@@ -148,23 +223,30 @@ namespace PAX {
 
         PAX_ENABLE_IF_SINGLE(bool)
         has() const {
+            const size_t index = PropertySignature::IndexOf<TProperty>();
+            if (PropertySignature::Covers(index)) {
+                return signature.test(index);
+            }
             return singleProperties.count(paxtypeid(TProperty)) > 0;
         }
 
         PAX_ENABLE_IF_MULTIPLE(bool)
         has() const {
+            const size_t index = PropertySignature::IndexOf<TProperty>();
+            if (PropertySignature::Covers(index)) {
+                return signature.test(index);
+            }
             return multipleProperties.count(paxtypeid(TProperty)) > 0;
         }
 
         template<class FirstTPropertyType, class SecondTPropertyType, class... FurtherTPropertyTypees>
         PAX_NODISCARD bool has() const {
-            bool X[] = { has<FirstTPropertyType>(), has<SecondTPropertyType>(), has<FurtherTPropertyTypees>()... };
-
-            constexpr int len = sizeof...(FurtherTPropertyTypees) + 2;
-            for (int i = 0; i < len; ++i)
-                if (!X[i]) return false;
+            static const bool covered = PropertySignature::CoversAll<FirstTPropertyType, SecondTPropertyType, FurtherTPropertyTypees...>();
+            if (covered) {
+                return signature.containsAll(PropertySignature::Of<FirstTPropertyType, SecondTPropertyType, FurtherTPropertyTypees...>());
+            }
 
-            return true;
+            return has<FirstTPropertyType>() && has<SecondTPropertyType>() && (has<FurtherTPropertyTypees>() && ...);
         }
 
         PAX_NODISCARD bool has(const TypeId & type, std::optional<bool> isMultipleHint = {}) const {
@@ -193,6 +275,11 @@ namespace PAX {
             return nullptr;
         }
 
+        /**
+         * @return All properties of type TProperty.
+         *         With PAX_WITH_FLAT_TYPE_MAP, the returned vector may move when properties of other types are added
+         *         or removed.
+         */
         PAX_ENABLE_IF_MULTIPLE(const std::vector<TProperty*>&)
         get() const {
             const auto& properties = multipleProperties.find(typeid(TProperty));
@@ -203,6 +290,14 @@ namespace PAX {
             }
         }
 
+        /**
+         * @return The set of property types this entity contains.
+         *         Property types beyond PropertySignature::Capacity are not represented.
+         */
+        PAX_NODISCARD const PropertySignature & getPropertySignature() const {
+            return signature;
+        }
+
         PAX_NODISCARD const std::vector<TRootProperty*> & getAllProperties() const {
             return get<TRootProperty>();
         }
@@ -292,22 +387,24 @@ namespace PAX {
         
         /// DANGER ZONE: Functions for internal use only !!!!!!!!!!!!!!
 
-        bool PAX_INTERNAL(addAsMultiple)(const TypeId & type, TRootProperty* property) {
+        bool PAX_INTERNAL(addAsMultiple)(const TypeId & type, size_t index, TRootProperty* property) {
             multipleProperties[type].push_back(property);
+            signature.set(index);
             return true;
         }
 
-        bool PAX_INTERNAL(addAsSingle)(const TypeId & type, TRootProperty* property) {
+        bool PAX_INTERNAL(addAsSingle)(const TypeId & type, size_t index, TRootProperty* property) {
             if (singleProperties.count(type)) {
                 return false;
             } else {
                 singleProperties[type] = property;
+                signature.set(index);
             }
 
             return true;
         }
 
-        bool PAX_INTERNAL(removeAsMultiple)(const TypeId & type, TRootProperty* property) {
+        bool PAX_INTERNAL(removeAsMultiple)(const TypeId & type, size_t index, TRootProperty* property) {
             std::vector<TRootProperty*> &result = multipleProperties.at(type);
             if (!Util::removeFromVector(result, property)) {
                 return false;
@@ -316,16 +413,58 @@ namespace PAX {
             // Remove vector if no propertys remain
             if (result.empty()) {
                 multipleProperties.erase(type);
+                signature.reset(index);
             }
 
             return true;
         }
 
-        bool PAX_INTERNAL(removeAsSingle)(const TypeId & type, TRootProperty* property) {
+        /**
+         * Replaces all references to the property at 'from' with 'to' after the property was moved to 'to'.
+         * Notifies the moved property and sends PropertyRelocatedEvents afterwards.
+         */
+        template<class TProperty>
+        void PAX_INTERNAL(relocate)(TProperty * from, TProperty * to) {
+            TRootProperty * oldProperty = static_cast<TRootProperty*>(from);
+            TRootProperty * newProperty = static_cast<TRootProperty*>(to);
+
+            for (auto & entry : singleProperties) {
+                if (entry.second == oldProperty) {
+                    entry.second = newProperty;
+                }
+            }
+
+            for (auto & entry : multipleProperties) {
+                std::replace(entry.second.begin(), entry.second.end(), oldProperty, newProperty);
+            }
+
+            // static_cast is necessary for the same reason described in method @ref add.
+            static_cast<Property<TDerived>*>(newProperty)->relocated(*static_cast<TDerived*>(this), oldProperty);
+
+            sendRelocatedEvents(from, to);
+        }
+
+        /**
+         * Sends a PropertyRelocatedEvent for TProperty and each of its super types,
+         * such that listeners for the super types (e.g., views caching them) notice the relocation, too.
+         */
+        template<class TProperty>
+        void sendRelocatedEvents(TProperty * from, TProperty * to) {
+            PropertyRelocatedEvent<TDerived, TProperty> event(to, from, static_cast<TDerived*>(this));
+            localEventService(event);
+
+            using Super = typename TProperty::Super;
+            PAX_CONSTEXPR_IF (!std::is_same<Super, Property<TDerived>>::value) {
+                sendRelocatedEvents<Super>(from, to);
+            }
+        }
+
+        bool PAX_INTERNAL(removeAsSingle)(const TypeId & type, size_t index, TRootProperty* property) {
             // The given property is not the property, that is registered for the given type.
             if (singleProperties.at(type) != property) {
                 return false;
             } else {
+                signature.reset(index);
                 return singleProperties.erase(type) != 0;
             }
         }
@@ -5,93 +5,269 @@
 #ifndef POLYPROPYLENE_PROPERTYSYSTEM_H
 #define POLYPROPYLENE_PROPERTYSYSTEM_H
 
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
 #include "EntityManager.h"
 
 namespace PAX {
+    /**
+     * Term for EntityManagerViews:
+     * Entities that contain any of the given properties are excluded from the view.
+     */
+    template<typename... Properties>
+    struct Without {};
+
+    /**
+     * Term for EntityManagerViews:
+     * The given properties are not required for entities to be in the view, but they are cached like required ones.
+     * EntityManagerView::each passes single properties as pointers that are nullptr if the entity does not contain them.
+     */
+    template<typename... Properties>
+    struct Optional {};
+
+    namespace Internal {
+        template<typename... Types>
+        struct TypeList {};
+
+        template<typename... Lists>
+        struct ConcatTypeLists {
+            using type = TypeList<>;
+        };
+
+        template<typename... Types>
+        struct ConcatTypeLists<TypeList<Types...>> {
+            using type = TypeList<Types...>;
+        };
+
+        template<typename... As, typename... Bs, typename... Rest>
+        struct ConcatTypeLists<TypeList<As...>, TypeList<Bs...>, Rest...> {
+            using type = typename ConcatTypeLists<TypeList<As..., Bs...>, Rest...>::type;
+        };
+
+        /// A property of type T that is cached by an EntityManagerView.
+        template<typename T, bool optional>
+        struct ViewAccess {
+            using Type = T;
+            static constexpr bool IsOptional = optional;
+        };
+
+        /**
+         * Splits a term of an EntityManagerView into the properties it requires, excludes, and caches.
+         * Plain property types are required.
+         */
+        template<typename Term>
+        struct ViewTerm {
+            using Required = TypeList<Term>;
+            using Excluded = TypeList<>;
+            using Cached = TypeList<ViewAccess<Term, false>>;
+        };
+
+        template<typename... Properties>
+        struct ViewTerm<Without<Properties...>> {
+            using Required = TypeList<>;
+            using Excluded = TypeList<Properties...>;
+            using Cached = TypeList<>;
+        };
+
+        template<typename... Properties>
+        struct ViewTerm<Optional<Properties...>> {
+            using Required = TypeList<>;
+            using Excluded = TypeList<>;
+            using Cached = TypeList<ViewAccess<Properties, true>...>;
+        };
+    }
+
     /**
      * EntityManagerViews filter the entities of an EntityManager by their containing properties.
      * The method EntityManagerView::getEntities() returns exactly those entities from the given manager that contain
      * the specified properties.
+     * Besides required properties, views may be declared with terms that
+     *  - exclude entities containing certain properties: Without<Frozen, Hidden>,
+     *  - cache certain properties if present: Optional<Sound>.
+     * For example, EntityManagerView<Pizza, TomatoSauce, Without<Champignon>, Optional<Cheese>> contains all pizzas
+     * with tomato sauce but without champignons.
+     *
+     * Views are updated incrementally whenever entities or properties are added or removed.
+     * Both take constant time independent of the number of entities in the view.
+     * The order of the entities is arbitrary (see sortByAddress()).
+     *
+     * Alongside each entity, the view caches pointers to its required and optional properties.
+     * The pointers are refreshed when the properties are relocated (e.g., by PropertyPool::compact).
+     * Use each() to iterate entities together with their properties without looking up any property:
+     *   EntityManagerView<Pizza, Champignon, TomatoSauce> view(manager);
+     *   view.each([](Pizza & pizza, Champignon & champignon, TomatoSauce & sauce) { ... });
+     *
+     * Required properties with single multiplicity are passed by reference, optional ones as pointers.
+     * For properties with multiple multiplicity, the vector of all such properties of the entity is passed
+     * as returned by Entity::getMultiple. Its elements have the root property type of the entity and have to be
+     * cast to the requested type:
+     *   EntityManagerView<Pizza, Cheese> view(manager);
+     *   view.each([](Pizza & pizza, const std::vector<Topping*> & cheeses) { ... });
      *
      * @tparam EntityType The concrete Entity type (i.e., the derived class)
-     * @tparam RequiredProperties A list of Property types that should be contained by filtered entities.
+     * @tparam Terms A list of Property types that should be contained by filtered entities,
+     *               optionally mixed with Without<...> and Optional<...> terms.
      */
-    template<typename EntityType, typename... RequiredProperties>
+    template<typename EntityType, typename... Terms>
     class EntityManagerView {
+        using Required = typename Internal::ConcatTypeLists<typename Internal::ViewTerm<Terms>::Required...>::type;
+        using Excluded = typename Internal::ConcatTypeLists<typename Internal::ViewTerm<Terms>::Excluded...>::type;
+        using CachedAccesses = typename Internal::ConcatTypeLists<typename Internal::ViewTerm<Terms>::Cached...>::type;
+
+        /**
+         * Describes how a cached property is stored for each entity and passed to each().
+         * Single properties are cached as pointers to them.
+         */
+        template<typename Access, bool multiple = Access::Type::IsMultiple()>
+        struct Cached {
+            using T = typename Access::Type;
+            using Pointer = T*;
+
+            static Pointer resolve(EntityType * entity) {
+                return entity->template get<T>();
+            }
+
+            static T & access(Pointer property, std::false_type /* optional */) {
+                return *property;
+            }
+
+            static T * access(Pointer property, std::true_type /* optional */) {
+                return property;
+            }
+
+            static decltype(auto) access(Pointer property) {
+                return access(property, std::integral_constant<bool, Access::IsOptional>());
+            }
+        };
+
+        /**
+         * Multiple properties are looked up when they are accessed.
+         * The vector holding all properties of type T in the entity may move when the entity
+         * gains or loses properties of other types (see TypeMap), so it cannot be cached.
+         * The vector is passed with the root property type as it is stored in the entity,
+         * because reinterpreting it as a vector of T would break strict aliasing.
+         */
+        template<typename Access>
+        struct Cached<Access, true> {
+            using T = typename Access::Type;
+            using Pointer = const EntityType*;
+
+            static Pointer resolve(EntityType * entity) {
+                return entity;
+            }
+
+            static const std::vector<typename EntityType::PropertyType*> & access(Pointer entity) {
+                return entity->getMultiple(paxtypeid(T));
+            }
+        };
+
+        template<typename Accesses>
+        struct Cache;
+
+        template<typename... Accesses>
+        struct Cache<Internal::TypeList<Accesses...>> {
+            using Tuple = std::tuple<typename Cached<Accesses>::Pointer...>;
+
+            static Tuple resolve(EntityType * entity) {
+                return Tuple(Cached<Accesses>::resolve(entity)...);
+            }
+
+            template<typename Function, size_t... Indices>
+            static void invoke(Function & f, EntityType * entity, const Tuple & properties, std::index_sequence<Indices...>) {
+                f(*entity, Cached<Accesses>::access(std::get<Indices>(properties))...);
+            }
+
+            template<typename Function>
+            static void invoke(Function & f, EntityType * entity, const Tuple & properties) {
+                invoke(f, entity, properties, std::index_sequence_for<Accesses...>());
+            }
+        };
+
+    public:
+        /// The cached properties of a single entity in the order they are declared in Terms.
+        using PropertyTuple = typename Cache<CachedAccesses>::Tuple;
+
+    private:
         const EntityManager<EntityType> & manager;
 
         /*
-         * Currently we are using a sorted set::vector here to optimize for iteration time.
-         * According to this (non-professional?) benchmark
-         * https://tinodidriksen.com/2010/04/cpp-set-performance/
-         * using a sorted vector is an order of magnitude faster than iterating a set.
-         * Insertions and deletions are faster for sets but the difference is less big.
-         *
-         * https://stackoverflow.com/questions/2710221/is-there-a-sorted-vector-class-which-supports-insert-etc
-         * Boost's flat_set might be a good alternative but I want to avoid introducing such a dependency.
-         * I cannot add just the file on its own to this project.
-         *
-         * Prove me wrong and open a pull-request if you have evidence that set is better. :)
+         * The view is a sparse set:
+         * Entities are stored densely in a vector such that iterating them is as fast as it can be.
+         * The index of each entity in that vector is stored in a hash map.
+         * Adding an entity appends it to the vector.
+         * Removing an entity moves the last entity into its place.
+         * Thus, neither has to shift the vector, which would be linear in the size of the view.
          */
         std::vector<EntityType*> entities;
+        std::unordered_map<EntityType*, size_t> indices;
+        /// The cached properties of each entity. properties[i] belongs to entities[i].
+        std::vector<PropertyTuple> properties;
 
     public:
         using iterator = typename decltype(entities)::iterator;
         using const_iterator = typename decltype(entities)::const_iterator;
 
     private:
+        template<typename... RequiredProperties, typename... ExcludedProperties>
+        static bool matches(EntityType * entity, Internal::TypeList<RequiredProperties...>, Internal::TypeList<ExcludedProperties...>) {
+            static const bool covered = PropertySignature::CoversAll<RequiredProperties..., ExcludedProperties...>();
+            if (covered) {
+                const PropertySignature & signature = entity->getPropertySignature();
+                return signature.containsAll(PropertySignature::Of<RequiredProperties...>())
+                    && !signature.containsAny(PropertySignature::Of<ExcludedProperties...>());
+            }
+
+            return (entity->template has<RequiredProperties>() && ...)
+                && !(entity->template has<ExcludedProperties>() || ...);
+        }
+
         bool isValid(EntityType * entity) {
-            return entity->template has<RequiredProperties...>();
+            return matches(entity, Required(), Excluded());
         }
 
         /**
-         * Returns an iterator to the given entity in the entities vector.
-         * If the entity is not yet in the vector, returns the position where
-         * the entities has to be inserted to keep the vector sorted.
+         * Adds the given entity if it matches the terms of this view and removes it otherwise.
+         * If the entity is contained already, its cached properties are resolved again.
          */
-        const_iterator find(EntityType * entity) const {
-            if (entities.empty()) {
-                return entities.begin();
-            }
-
-            int64_t first = 0;
-            int64_t last = entities.size() - 1;
-            // inserted sorted by pointer to improve caching on iterating
-            while (first < last) {
-                int64_t mid = (first + last) / 2;
-                EntityType * entityInMid = entities.at(mid);
-                if (entityInMid == entity) {
-                    first = mid;
-                    break;
-                } else if (entityInMid < entity) {
-                    first = mid + 1;
-                } else { // entity < entityInMid
-                    last  = mid - 1;
-                }
+        void update(EntityType * entity) {
+            if (!isValid(entity)) {
+                remove(entity);
+                return;
             }
-            return entities.begin() + first;
-        }
 
-        void tryAdd(EntityType * entity) {
-            if (isValid(entity)) {
-                const const_iterator it = find(entity);
-                if (entities.empty() || *it != entity) { // If the given entity is not already in the vector
-                    entities.insert(it, entity);
-                }
+            const auto inserted = indices.emplace(entity, entities.size());
+            if (inserted.second) {
+                entities.push_back(entity);
+                properties.push_back(Cache<CachedAccesses>::resolve(entity));
+            } else {
+                properties[inserted.first->second] = Cache<CachedAccesses>::resolve(entity);
             }
         }
 
         void remove(EntityType * entity) {
-            const const_iterator it = find(entity);
-            const bool isRightEntity = entity == *it;
-            if (isRightEntity) {
-                entities.erase(it);
+            const auto it = indices.find(entity);
+            if (it == indices.end()) {
+                return;
+            }
+
+            const size_t index = it->second;
+            indices.erase(it);
+            if (index + 1 < entities.size()) {
+                EntityType * last = entities.back();
+                entities[index] = last;
+                properties[index] = properties.back();
+                indices[last] = index;
             }
-//                entities.erase(entity); // when using set
+            entities.pop_back();
+            properties.pop_back();
         }
 
         template<bool add, typename T>
-        void unfoldPropertyEventListeners(EventService & e) {
+        void listenToProperty(EventService & e) {
             PAX_CONSTEXPR_IF (add) {
                 e.add<PropertyAttachedEvent<EntityType, T>, EntityManagerView, &EntityManagerView::onPropertyAttached>(this);
                 e.add<PropertyDetachedEvent<EntityType, T>, EntityManagerView, &EntityManagerView::onPropertyDetached>(this);
@@ -101,55 +277,106 @@ namespace PAX {
             }
         }
 
-        template<bool add, typename T, typename T2, typename... Others>
+        template<bool add, typename Access>
+        void listenToOptionalProperty(EventService & e) {
+            // Required properties are cached as well but we listen to them already.
+            PAX_CONSTEXPR_IF (Access::IsOptional) {
+                listenToProperty<add, typename Access::Type>(e);
+            }
+        }
+
+        template<bool add, typename Access>
+        void listenToRelocations(EventService & e) {
+            // Multiple properties are looked up on access, so only cached pointers to single properties can dangle.
+            PAX_CONSTEXPR_IF (!Access::Type::IsMultiple()) {
+                using Event = PropertyRelocatedEvent<EntityType, typename Access::Type>;
+                PAX_CONSTEXPR_IF (add) {
+                    e.add<Event, EntityManagerView, &EntityManagerView::onPropertyRelocated>(this);
+                } else {
+                    e.remove<Event, EntityManagerView, &EntityManagerView::onPropertyRelocated>(this);
+                }
+            }
+        }
+
+        /**
+         * (Un)registers for attach and detach events of all required, excluded, and optional properties
+         * as each of them may change the membership or the cached properties of an entity.
+         * Also (un)registers for relocations of cached properties (e.g., by PropertyPool::compact).
+         */
+        template<bool add, typename... RequiredProperties, typename... ExcludedProperties, typename... CachedAccessTypes>
+        void unfoldPropertyEventListeners(EventService & e,
+                Internal::TypeList<RequiredProperties...>,
+                Internal::TypeList<ExcludedProperties...>,
+                Internal::TypeList<CachedAccessTypes...>) {
+            (listenToProperty<add, RequiredProperties>(e), ...);
+            (listenToProperty<add, ExcludedProperties>(e), ...);
+            (listenToOptionalProperty<add, CachedAccessTypes>(e), ...);
+            (listenToRelocations<add, CachedAccessTypes>(e), ...);
+        }
+
+        template<bool add>
         void unfoldPropertyEventListeners(EventService & e) {
-            unfoldPropertyEventListeners<add, T>(e);
-            unfoldPropertyEventListeners<add, T2>(e);
-            unfoldPropertyEventListeners<add, Others...>(e);
+            unfoldPropertyEventListeners<add>(e, Required(), Excluded(), CachedAccesses());
         }
 
     public:
         explicit EntityManagerView(const EntityManager<EntityType> & manager) : manager(manager) {
             for (EntityType * entity : manager.getEntities()) {
-                tryAdd(entity);
+                update(entity);
             }
 
             manager.getEventService().template add<EntityAddedEvent<EntityType>, EntityManagerView, &EntityManagerView::onEntityAdded>(this);
             manager.getEventService().template add<EntityRemovedEvent<EntityType>, EntityManagerView, &EntityManagerView::onEntityRemoved>(this);
+            manager.getEventService().template add<WorldClearedEvent<EntityType>, EntityManagerView, &EntityManagerView::onWorldCleared>(this);
 
-            unfoldPropertyEventListeners<true, RequiredProperties...>(manager.getEventService());
+            unfoldPropertyEventListeners<true>(manager.getEventService());
         }
 
-        explicit EntityManagerView(const EntityManagerView<EntityType, RequiredProperties...> & other) = delete;
+        explicit EntityManagerView(const EntityManagerView<EntityType, Terms...> & other) = delete;
         // TODO: Delete this, too? All event service pointers will invalide on move right?
-//        EntityManagerView(EntityManagerView<EntityType, RequiredProperties...> && other) noexcept = default;
+//        EntityManagerView(EntityManagerView<EntityType, Terms...> && other) noexcept = default;
 
         virtual ~EntityManagerView() {
             // It is unnecessary to remove all entities by hand.
 
             manager.getEventService().template remove<EntityAddedEvent<EntityType>, EntityManagerView, &EntityManagerView::onEntityAdded>(this);
             manager.getEventService().template remove<EntityRemovedEvent<EntityType>, EntityManagerView, &EntityManagerView::onEntityRemoved>(this);
+            manager.getEventService().template remove<WorldClearedEvent<EntityType>, EntityManagerView, &EntityManagerView::onWorldCleared>(this);
 
-            unfoldPropertyEventListeners<false, RequiredProperties...>(manager.getEventService());
+            unfoldPropertyEventListeners<false>(manager.getEventService());
         }
 
         void onEntityAdded(EntityAddedEvent<EntityType> & e) {
-            tryAdd(e.entity);
+            update(e.entity);
         }
 
         void onEntityRemoved(EntityRemovedEvent<EntityType> & e) {
             remove(e.entity);
         }
 
+        void onWorldCleared(WorldClearedEvent<EntityType> & e) {
+            if (&e.manager == &manager) {
+                entities.clear();
+                indices.clear();
+                properties.clear();
+            }
+        }
+
         template<typename Prop>
         void onPropertyAttached(PropertyAttachedEvent<EntityType, Prop> & e) {
-            tryAdd(e.entity);
+            update(e.entity);
         }
 
         template<typename Prop>
         void onPropertyDetached(PropertyDetachedEvent<EntityType, Prop> & e) {
-            if (!isValid(e.entity)) {
-                remove(e.entity);
+            update(e.entity);
+        }
+
+        template<typename Prop>
+        void onPropertyRelocated(PropertyRelocatedEvent<EntityType, Prop> & e) {
+            const auto it = indices.find(e.entity);
+            if (it != indices.end()) {
+                properties[it->second] = Cache<CachedAccesses>::resolve(e.entity);
             }
         }
 
@@ -157,10 +384,67 @@ namespace PAX {
             return entities;
         }
 
+        /**
+         * @return The cached properties of all entities in this view.
+         *         The i-th tuple belongs to the i-th entity in getEntities().
+         *         Properties with multiple multiplicity are represented by their entity (see Cached).
+         */
+        PAX_NODISCARD const std::vector<PropertyTuple> & getProperties() const {
+            return properties;
+        }
+
+        /**
+         * Invokes the given function for each entity in this view with the entity and its cached properties
+         * in the order they are declared in Terms. Excluded properties are omitted:
+         *   EntityManagerView<E, A, Without<B>, Optional<C>> calls f(E &, A &, C *)
+         * The properties are taken from the cache of this view such that no property has to be looked up.
+         * The function must not add or remove properties of a type in Terms or entities.
+         * @param f The function to invoke.
+         */
+        template<typename Function>
+        void each(Function && f) const {
+            for (size_t i = 0; i < entities.size(); ++i) {
+                Cache<CachedAccesses>::invoke(f, entities[i], properties[i]);
+            }
+        }
+
         PAX_NODISCARD size_t size() const noexcept {
             return entities.size();
         }
 
+        /**
+         * @return True iff the given entity is contained in this view.
+         */
+        PAX_NODISCARD bool contains(EntityType * entity) const {
+            return indices.find(entity) != indices.end();
+        }
+
+        /**
+         * Sorts the entities of this view by their address.
+         * As entities are usually allocated in pools, this restores the order of entities in memory,
+         * which improves caching when iterating the view.
+         * The order is not maintained by subsequent changes of the view.
+         */
+        void sortByAddress() {
+            std::vector<size_t> order(entities.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+                return entities[a] < entities[b];
+            });
+
+            std::vector<EntityType*> sortedEntities(entities.size());
+            std::vector<PropertyTuple> sortedProperties(properties.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                sortedEntities[i] = entities[order[i]];
+                sortedProperties[i] = properties[order[i]];
+                indices[sortedEntities[i]] = i;
+            }
+            entities = std::move(sortedEntities);
+            properties = std::move(sortedProperties);
+        }
+
         iterator begin() { return entities.begin(); }
         iterator end() { return entities.end(); }
         const_iterator begin() const { return entities.begin(); }
@@ -6,6 +6,8 @@
 #define POLYPROPYLENE_FORWARDDECLARATIONS_H
 
 namespace PAX {
+    class AllocationService;
+
     template<class TEntityType>
     class Property;
 
@@ -10,6 +10,7 @@
 #include "polypropylene/reflection/Reflectable.h"
 #include "event/PropertyAttachedEvent.h"
 #include "event/PropertyDetachedEvent.h"
+#include "event/PropertyRelocatedEvent.h"
 
 namespace PAX {
     template<class TEntityType>
@@ -24,6 +25,9 @@ namespace PAX {
     private:
         TEntityType * owner = nullptr;
 
+        /// The service this property was allocated with. It is deleted with it (@ref pax_delete).
+        AllocationService * allocationService = &TEntityType::GetAllocationService();
+
     protected:
         virtual bool PAX_INTERNAL(addTo)(TEntityType & entity) PAX_NON_CONST { return true; }
         virtual bool PAX_INTERNAL(removeFrom)(TEntityType & entity) PAX_NON_CONST { return true; }
@@ -40,10 +44,40 @@ namespace PAX {
          */
         virtual void detached(TEntityType & entity) {}
 
+        /**
+         * Callback that is invoked on an attached property after it was moved to another memory location
+         * (e.g., by PropertyPool::compact).
+         * Override this if this property registered its address somewhere, for example as an event listener.
+         * @param entity The entity this property is attached to.
+         * @param oldLocation The previous location of this property. The moved-from object there is alive only for the
+         *                    duration of this call and is destroyed afterwards, so do not keep the pointer.
+         */
+        virtual void relocated(TEntityType & entity, Property * oldLocation) {}
+
     public:
         Property() = default;
+
+        /**
+         * Copies keep the owner of the given property but belong to the service currently bound to TEntityType
+         * as that is the one they are allocated with (e.g., by pax_new).
+         */
+        Property(const Property & other) : Polymorphic(other), Reflectable(other), owner(other.owner) {}
+
+        Property & operator=(const Property & other) {
+            owner = other.owner;
+            return *this;
+        }
+
         virtual ~Property() = default;
 
+        /**
+         * @return The AllocationService that was in use when this property was created.
+         *         pax_delete deletes this property with this service, regardless of the service bound at that time.
+         */
+        PAX_NODISCARD AllocationService & getAllocationService() const {
+            return *allocationService;
+        }
+
         /**
          * @return The entity this property is attached to. Returns nullptr if this property is not attached to an entity.
          */
@@ -7,6 +7,7 @@
 
 #include "PropertyDependencies.h"
 #include "PropertyFactory.h"
+#include "PropertySignature.h"
 #include "event/PropertyAttachedEvent.h"
 #include "event/PropertyDetachedEvent.h"
 
@@ -19,9 +20,9 @@
 bool Type::methodName(EntityType & e) { \
     if (Super::methodName(e)) { \
         PAX_CONSTEXPR_IF (Type::IsMultiple()) { \
-            if (!e.asMultiple(paxtypeid(Type), this)) return false; \
+            if (!e.asMultiple(paxtypeid(Type), ::PAX::PropertySignature::IndexOf<Type>(), this)) return false; \
         } else { \
-            if (!e.asSingle(paxtypeid(Type), this)) return false; \
+            if (!e.asSingle(paxtypeid(Type), ::PAX::PropertySignature::IndexOf<Type>(), this)) return false; \
         } \
         EventType<EntityType, Type> event(this, &e); \
         e.getEventService()(event); \
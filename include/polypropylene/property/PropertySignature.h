@@ -0,0 +1,144 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_PROPERTYSIGNATURE_H
+#define POLYPROPYLENE_PROPERTYSIGNATURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "polypropylene/definitions/Definitions.h"
+#include "polypropylene/reflection/TypeIndex.h"
+
+/**
+ * The number of 64 bit words in each PropertySignature.
+ * Property types with an index beyond the capacity of signatures are looked up in the property maps of entities instead.
+ */
+#ifndef PAX_PROPERTY_SIGNATURE_WORDS
+#define PAX_PROPERTY_SIGNATURE_WORDS 2
+#endif
+
+namespace PAX {
+    /**
+     * A set of property types stored as a bitset.
+     * Each property type is assigned a dense index on first use (@ref IndexOf).
+     * Entities keep the signature of the property types they contain, such that checking for multiple
+     * property types at once is a masked AND over a few machine words instead of one map lookup per type.
+     */
+    class PropertySignature {
+    public:
+        using Word = uint64_t;
+        static constexpr size_t NumberOfWords = PAX_PROPERTY_SIGNATURE_WORDS;
+        static constexpr size_t BitsPerWord = 64;
+        /// The number of property types that can be represented in a signature.
+        static constexpr size_t Capacity = NumberOfWords * BitsPerWord;
+
+    private:
+        Word words[NumberOfWords] = {};
+
+    public:
+        /**
+         * @return The dense index of the given property type. Indices are assigned in order of first use.
+         *         Property types are a kind of their own in the TypeIndexRegistry, such that their indices
+         *         are not spread by the indices of other types.
+         */
+        template<typename Property>
+        PAX_NODISCARD static size_t IndexOf() {
+            return TypeIndexRegistry::OfKind<PropertySignature, Property>();
+        }
+
+        /**
+         * @return True iff the given index can be represented in a signature.
+         */
+        PAX_NODISCARD static constexpr bool Covers(size_t index) {
+            return index < Capacity;
+        }
+
+        /**
+         * @return True iff all given property types can be represented in a signature.
+         */
+        template<typename... Properties>
+        PAX_NODISCARD static bool CoversAll() {
+            return (Covers(IndexOf<Properties>()) && ...);
+        }
+
+        /**
+         * @return The signature containing the given property types that can be represented in a signature.
+         */
+        template<typename... Properties>
+        PAX_NODISCARD static const PropertySignature & Of() {
+            static const PropertySignature signature = []() {
+                PropertySignature created;
+                (created.set(IndexOf<Properties>()), ...);
+                return created;
+            }();
+            return signature;
+        }
+
+        /**
+         * Adds the property type with the given index to this signature.
+         * Indices that are not covered are ignored.
+         */
+        void set(size_t index) {
+            if (Covers(index)) {
+                words[index / BitsPerWord] |= Word(1) << (index % BitsPerWord);
+            }
+        }
+
+        /**
+         * Removes the property type with the given index from this signature.
+         */
+        void reset(size_t index) {
+            if (Covers(index)) {
+                words[index / BitsPerWord] &= ~(Word(1) << (index % BitsPerWord));
+            }
+        }
+
+        /**
+         * @return True iff the property type with the given index is contained in this signature.
+         *         Always false for indices that are not covered.
+         */
+        PAX_NODISCARD bool test(size_t index) const {
+            return Covers(index) && (words[index / BitsPerWord] >> (index % BitsPerWord)) & Word(1);
+        }
+
+        /**
+         * @return True iff all property types in the given signature are contained in this signature.
+         */
+        PAX_NODISCARD bool containsAll(const PropertySignature & other) const {
+            for (size_t i = 0; i < NumberOfWords; ++i) {
+                if ((words[i] & other.words[i]) != other.words[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @return True iff this signature and the given one share at least one property type.
+         */
+        PAX_NODISCARD bool containsAny(const PropertySignature & other) const {
+            for (size_t i = 0; i < NumberOfWords; ++i) {
+                if (words[i] & other.words[i]) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool operator==(const PropertySignature & other) const {
+            for (size_t i = 0; i < NumberOfWords; ++i) {
+                if (words[i] != other.words[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator!=(const PropertySignature & other) const {
+            return !(*this == other);
+        }
+    };
+}
+
+#endif //POLYPROPYLENE_PROPERTYSIGNATURE_H
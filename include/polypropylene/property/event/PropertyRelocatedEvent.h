@@ -0,0 +1,29 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_PROPERTYRELOCATEDEVENT_H
+#define POLYPROPYLENE_PROPERTYRELOCATEDEVENT_H
+
+#include "EntityEvent.h"
+
+namespace PAX {
+    /**
+     * Sent when a property was moved to another memory location (e.g., by PropertyPool::compact).
+     * Anyone holding a pointer to the property has to replace oldLocation with property.
+     */
+    template <typename EntityType, class Prop>
+    struct PropertyRelocatedEvent : public EntityEvent<EntityType> {
+        /// The new location of the property.
+        Prop * property;
+
+        /// The old location of the property. The moved-from object there is destroyed after the event was sent,
+        /// so do not keep the pointer.
+        Prop * oldLocation;
+
+        PropertyRelocatedEvent(Prop * prop, Prop * oldLocation, EntityType * entity)
+                : EntityEvent<EntityType>(entity), property(prop), oldLocation(oldLocation) {}
+    };
+}
+
+#endif //POLYPROPYLENE_PROPERTYRELOCATEDEVENT_H
@@ -15,8 +15,16 @@ namespace PAX {
     struct Type {
         TypeId id;
         size_t size;
-
-        Type(const TypeId & type, size_t size);
+        /// The alignment requirement of objects of this type in bytes (a power of two).
+        size_t alignment;
+
+        /**
+         * @param type The id of the type.
+         * @param size The size of objects of the type in bytes.
+         * @param alignment The alignment of objects of the type in bytes.
+         *                  If 0, the greatest power of two dividing size is used, capped at alignof(std::max_align_t).
+         */
+        Type(const TypeId & type, size_t size, size_t alignment = 0);
         PAX_NODISCARD const char * name() const noexcept;
         PAX_NODISCARD size_t hash_code() const noexcept;
         bool operator==(const Type & other) const noexcept;
@@ -40,6 +48,6 @@ namespace PAX {
 }
 
 #define paxtypeid(...) typeid(__VA_ARGS__)
-#define paxtypeof(...) ::PAX::Type(paxtypeid(__VA_ARGS__), sizeof(__VA_ARGS__))
+#define paxtypeof(...) ::PAX::Type(paxtypeid(__VA_ARGS__), sizeof(__VA_ARGS__), alignof(__VA_ARGS__))
 
 #endif //POLYPROPYLENE_TYPEINFO_H
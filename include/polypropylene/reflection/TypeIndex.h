@@ -0,0 +1,87 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_TYPEINDEX_H
+#define POLYPROPYLENE_TYPEINDEX_H
+
+#include <cstdint>
+#include <limits>
+#include "Type.h"
+
+namespace PAX {
+    /**
+     * A small integer identifying a type at runtime.
+     * Indices are assigned sequentially starting at 0 in order of first use.
+     * Thus, they can be used as indices into arrays and bitsets, and comparing them is a single integer comparison
+     * in contrast to comparing std::type_info objects (which might compare mangled names on some ABIs).
+     * Beware that indices are not stable across program runs, so do not serialise them.
+     */
+    using TypeIndex = uint32_t;
+
+    /**
+     * Assigns dense TypeIndices to types.
+     * Use paxtypeindex(T) to obtain the index of a type T.
+     */
+    class TypeIndexRegistry {
+        /**
+         * Returns the index of the given type and assigns the next free index if the type has none yet.
+         * Takes a lock, so it is called only once per type by Of.
+         */
+        static TypeIndex Register(const TypeId & type);
+
+        /**
+         * Returns the index of the given type among the types of the given kind and assigns the next free index
+         * of that kind if the type has none yet.
+         * Takes a lock, so it is called only once per kind and type by OfKind.
+         */
+        static TypeIndex RegisterInKind(const TypeId & kind, const TypeId & type);
+
+    public:
+        static constexpr TypeIndex InvalidIndex = std::numeric_limits<TypeIndex>::max();
+
+        /**
+         * @return The index of type T. After the first call, this is a single load of a static variable.
+         */
+        template<typename T>
+        PAX_NODISCARD static TypeIndex Of() {
+            static const TypeIndex index = Register(paxtypeid(T));
+            return index;
+        }
+
+        /**
+         * Each kind of types (e.g., property types) counts its indices separately, such that the indices of a kind
+         * are dense even if many types of other kinds were assigned indices before.
+         * This allows using them for small bitsets (e.g., PropertySignature).
+         * @tparam Kind A type naming the kind. Only its identity matters.
+         * @return The index of type T among all types of the given kind.
+         *         After the first call, this is a single load of a static variable.
+         */
+        template<typename Kind, typename T>
+        PAX_NODISCARD static TypeIndex OfKind() {
+            static const TypeIndex index = RegisterInKind(paxtypeid(Kind), paxtypeid(T));
+            return index;
+        }
+
+        /**
+         * @return The index of the given type or InvalidIndex if the type was not assigned an index yet.
+         */
+        PAX_NODISCARD static TypeIndex Find(const TypeId & type);
+
+        /**
+         * @return The type with the given index.
+         *         Throws if no type was assigned the given index yet.
+         */
+        PAX_NODISCARD static TypeId GetTypeId(TypeIndex index);
+
+        /**
+         * @return The number of types that were assigned an index so far.
+         *         All indices are smaller than this number.
+         */
+        PAX_NODISCARD static size_t GetNumberOfTypes();
+    };
+}
+
+#define paxtypeindex(...) ::PAX::TypeIndexRegistry::Of<__VA_ARGS__>()
+
+#endif //POLYPROPYLENE_TYPEINDEX_H
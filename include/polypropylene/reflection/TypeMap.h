@@ -5,89 +5,178 @@
 #ifndef POLYPROPYLENE_TYPEMAP_H
 #define POLYPROPYLENE_TYPEMAP_H
 
-#include <typeindex>
+#include <algorithm>
 #include <map>
+#include <stdexcept>
+#include <typeindex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "polypropylene/reflection/Type.h"
 
 namespace PAX {
-#define PAX_TYPE_MAP_LIGHTWEIGHT
+    /**
+     * A map from TypeIds to values that stores its entries in a single vector sorted by TypeId.
+     * It is meant for the small maps held by each entity, for which a node based std::map spends
+     * one heap allocation per entry and a pointer chase per comparison.
+     * Lookups are a binary search over contiguous memory and iteration is in the same order as for std::map.
+     *
+     * In contrast to std::map, inserting or erasing entries moves other entries.
+     * Thus, iterators, pointers, and references to entries are invalidated by insertions and erasures.
+     * @tparam ValueType The type of the values.
+     * @tparam Allocator The allocator for the entries of type std::pair<TypeId, ValueType>.
+     */
+    template<typename ValueType, class Allocator = std::allocator<std::pair<TypeId, ValueType>>>
+    class FlatTypeMap {
+    public:
+        using key_type = TypeId;
+        using mapped_type = ValueType;
+        using value_type = std::pair<TypeId, ValueType>;
+        using allocator_type = Allocator;
 
-#ifdef PAX_TYPE_MAP_LIGHTWEIGHT
-    template<typename ValueType>
-    using TypeMap = std::map<TypeId, ValueType>;
+    private:
+        using Entries = std::vector<value_type, Allocator>;
+        Entries entries;
 
-    template<typename ValueType>
-    using UnorderedTypeMap = std::unordered_map<TypeId, ValueType>;
-#else
-    template<typename ValueType, class Map = std::unordered_map<TypeId, ValueType>>
-    class TypeMap {
-        Map _map;
+        static bool isBefore(const value_type & entry, const TypeId & type) {
+            return entry.first < type;
+        }
 
     public:
-        using iterator = typename Map::iterator;
-        using const_iterator = typename Map::const_iterator;
+        using size_type = typename Entries::size_type;
+        using iterator = typename Entries::iterator;
+        using const_iterator = typename Entries::const_iterator;
 
-        template<typename Value>
-        inline bool contains() const {
-            return _map.find(paxtypeof(Value)) != _map.end();
+        PAX_NODISCARD iterator lower_bound(const TypeId & type) {
+            return std::lower_bound(entries.begin(), entries.end(), type, &isBefore);
         }
 
-        inline bool contains(const TypeId &index) const {
-            return _map.find(index) != _map.end();
+        PAX_NODISCARD const_iterator lower_bound(const TypeId & type) const {
+            return std::lower_bound(entries.begin(), entries.end(), type, &isBefore);
         }
 
-        template<typename Key>
-        inline ValueType& get() {
-            return _map.at(paxtypeof(Key));
+        PAX_NODISCARD iterator find(const TypeId & type) {
+            const iterator it = lower_bound(type);
+            return it != entries.end() && it->first == type ? it : entries.end();
         }
 
-        ValueType& get(const TypeId &index) {
-            return _map.at(index);
+        PAX_NODISCARD const_iterator find(const TypeId & type) const {
+            const const_iterator it = lower_bound(type);
+            return it != entries.end() && it->first == type ? it : entries.end();
         }
 
-        ValueType& operator[](const TypeId &index) {
-            return _map[index];
+        PAX_NODISCARD size_type count(const TypeId & type) const {
+            return find(type) != entries.end() ? 1 : 0;
         }
 
-        template<typename Key>
-        bool put(const ValueType & value) {
-            _map[paxtypeof(Key)] = value;
-            return true;
+        PAX_NODISCARD bool contains(const TypeId & type) const {
+            return find(type) != entries.end();
         }
 
-        bool put(const TypeId &index, const ValueType & value) {
-            _map[index] = value;
-            return true;
+        /**
+         * @return The value for the given type.
+         *         Throws std::out_of_range if there is none, just as std::map::at.
+         */
+        PAX_NODISCARD ValueType & at(const TypeId & type) {
+            const iterator it = find(type);
+            if (it == entries.end()) {
+                throw std::out_of_range("FlatTypeMap::at: no value for given type");
+            }
+            return it->second;
         }
 
-        /// Returns the number of erased elements
-        template<typename Key>
-        size_t erase() {
-            return _map.erase(paxtypeof(Key));
+        PAX_NODISCARD const ValueType & at(const TypeId & type) const {
+            const const_iterator it = find(type);
+            if (it == entries.end()) {
+                throw std::out_of_range("FlatTypeMap::at: no value for given type");
+            }
+            return it->second;
         }
 
-        size_t erase(const TypeId &index) {
-            return _map.erase(index);
+        ValueType & operator[](const TypeId & type) {
+            return try_emplace(type).first->second;
         }
 
-        bool empty() const {
-            return _map.empty();
+        /**
+         * Constructs a value from the given arguments if there is no value for the given type yet.
+         * @return The entry for the given type and true iff it was inserted.
+         */
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(const TypeId & type, Args&&... args) {
+            const iterator it = lower_bound(type);
+            if (it != entries.end() && it->first == type) {
+                return {it, false};
+            }
+            return {entries.emplace(it, std::piecewise_construct, std::forward_as_tuple(type), std::forward_as_tuple(std::forward<Args>(args)...)), true};
         }
 
-        void clear() {
-            _map.clear();
+        template<typename... Args>
+        std::pair<iterator, bool> emplace(const TypeId & type, Args&&... args) {
+            return try_emplace(type, std::forward<Args>(args)...);
         }
 
-        iterator begin() { return _map.begin(); }
-        iterator end() { return _map.end(); }
-        const_iterator begin() const { return _map.begin(); }
-        const_iterator end() const { return _map.end(); }
-        const_iterator cbegin() const { return _map.cbegin(); }
-        const_iterator cend() const { return _map.cend(); }
+        std::pair<iterator, bool> insert(const value_type & entry) {
+            return try_emplace(entry.first, entry.second);
+        }
+
+        template<typename Value>
+        std::pair<iterator, bool> insert_or_assign(const TypeId & type, Value && value) {
+            std::pair<iterator, bool> result = try_emplace(type, std::forward<Value>(value));
+            if (!result.second) {
+                result.first->second = std::forward<Value>(value);
+            }
+            return result;
+        }
+
+        iterator erase(const_iterator position) {
+            return entries.erase(position);
+        }
+
+        /// Returns the number of erased elements
+        size_type erase(const TypeId & type) {
+            const const_iterator it = find(type);
+            if (it == entries.end()) {
+                return 0;
+            }
+            entries.erase(it);
+            return 1;
+        }
+
+        PAX_NODISCARD size_type size() const { return entries.size(); }
+        PAX_NODISCARD bool empty() const { return entries.empty(); }
+        void clear() { entries.clear(); }
+        void reserve(size_type capacity) { entries.reserve(capacity); }
+
+        /**
+         * @return The number of entries this map can hold before it has to reallocate.
+         */
+        PAX_NODISCARD size_type capacity() const { return entries.capacity(); }
+
+        iterator begin() { return entries.begin(); }
+        iterator end() { return entries.end(); }
+        const_iterator begin() const { return entries.begin(); }
+        const_iterator end() const { return entries.end(); }
+        const_iterator cbegin() const { return entries.cbegin(); }
+        const_iterator cend() const { return entries.cend(); }
     };
+
+    /**
+     * The map used to associate values with types throughout Polypropylene.
+     * With PAX_WITH_FLAT_TYPE_MAP (cmake option POLYPROPYLENE_WITH_FLAT_TYPE_MAP), this is a FlatTypeMap.
+     * Otherwise, it is a std::map.
+     * Code using a TypeMap should not rely on iterators or references remaining valid across insertions or erasures.
+     */
+#ifdef PAX_WITH_FLAT_TYPE_MAP
+    template<typename ValueType>
+    using TypeMap = FlatTypeMap<ValueType>;
+#else
+    template<typename ValueType>
+    using TypeMap = std::map<TypeId, ValueType>;
 #endif
+
+    template<typename ValueType>
+    using UnorderedTypeMap = std::unordered_map<TypeId, ValueType>;
 }
 
 #endif //POLYPROPYLENE_TYPEMAP_H
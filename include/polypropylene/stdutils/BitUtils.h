@@ -0,0 +1,58 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_BITUTILS_H
+#define POLYPROPYLENE_BITUTILS_H
+
+#include <cstdint>
+#include "polypropylene/definitions/CompilerDetection.h"
+
+#ifdef PAX_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+namespace PAX {
+    namespace Util {
+        /**
+         * @return The index of the least significant set bit in x.
+         *         The result is undefined if x is 0.
+         */
+        inline unsigned int countTrailingZeros(uint64_t x) {
+#ifdef PAX_COMPILER_MSVC
+            unsigned long index;
+            _BitScanForward64(&index, x);
+            return static_cast<unsigned int>(index);
+#else
+            return static_cast<unsigned int>(__builtin_ctzll(x));
+#endif
+        }
+
+        /**
+         * @return The number of unset bits above the most significant set bit in x.
+         *         The result is undefined if x is 0.
+         */
+        inline unsigned int countLeadingZeros(uint64_t x) {
+#ifdef PAX_COMPILER_MSVC
+            unsigned long index;
+            _BitScanReverse64(&index, x);
+            return 63u - static_cast<unsigned int>(index);
+#else
+            return static_cast<unsigned int>(__builtin_clzll(x));
+#endif
+        }
+
+        /**
+         * @return The number of set bits in x.
+         */
+        inline unsigned int popCount(uint64_t x) {
+#ifdef PAX_COMPILER_MSVC
+            return static_cast<unsigned int>(__popcnt64(x));
+#else
+            return static_cast<unsigned int>(__builtin_popcountll(x));
+#endif
+        }
+    }
+}
+
+#endif //POLYPROPYLENE_BITUTILS_H
@@ -3,8 +3,31 @@
 //
 
 #include <polypropylene/event/EventService.h>
+#include <algorithm>
 
 namespace PAX {
+    EventService::~EventService() {
+        for (const ListenerList & listenerList : _listeners) {
+            listenerList.deleteDelegates(listenerList.delegates);
+        }
+    }
+
+    void * EventService::findDelegates(TypeIndex event) const {
+        const auto it = std::lower_bound(_listeners.begin(), _listeners.end(), event, &EventService::isBefore);
+        if (it != _listeners.end() && it->event == event) {
+            return it->delegates;
+        }
+        return nullptr;
+    }
+
+    void * EventService::findOrInsertDelegates(const ListenerList & listenerList) {
+        auto it = std::lower_bound(_listeners.begin(), _listeners.end(), listenerList.event, &EventService::isBefore);
+        if (it == _listeners.end() || it->event != listenerList.event) {
+            it = _listeners.insert(it, listenerList);
+        }
+        return it->delegates;
+    }
+
     EventService* EventService::getParent() {
         return _parent;
     }
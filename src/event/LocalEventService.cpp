@@ -0,0 +1,32 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include <polypropylene/event/LocalEventService.h>
+
+namespace PAX {
+    LocalEventService::~LocalEventService() = default;
+
+    void LocalEventService::setParent(EventService * parent) {
+        this->parent = parent;
+        if (service) {
+            service->setParent(parent);
+        }
+    }
+
+    EventService * LocalEventService::getParent() const {
+        return parent;
+    }
+
+    EventService * LocalEventService::get() const {
+        return service.get();
+    }
+
+    EventService & LocalEventService::getOrCreate() {
+        if (!service) {
+            service = std::make_unique<EventService>();
+            service->setParent(parent);
+        }
+        return *service;
+    }
+}
@@ -3,31 +3,218 @@
 //
 
 #include <polypropylene/memory/AllocationService.h>
+#include <polypropylene/memory/allocators/ChainedAllocator.h>
+#include <polypropylene/memory/allocators/ConcurrentAllocator.h>
+#include <polypropylene/memory/allocators/SizeClassAllocator.h>
+#include <fstream>
 
 namespace PAX {
+    namespace {
+        std::atomic<uint64_t> NextAllocationServiceId { 0 };
+
+        /**
+         * @return The PoolAllocator the given allocator allocates from.
+         *         Returns nullptr if it does not allocate from a PoolAllocator.
+         */
+        PoolAllocator * PoolOf(Allocator * allocator) {
+            if (auto * sizeClass = dynamic_cast<SizeClassAllocator*>(allocator)) {
+                allocator = sizeClass->getSizeClass().get();
+            }
+            if (auto * concurrent = dynamic_cast<ConcurrentAllocator*>(allocator)) {
+                allocator = concurrent->getBackend().get();
+            }
+            if (auto * chained = dynamic_cast<ChainedAllocator*>(allocator)) {
+                allocator = chained->getPrimary().get();
+            }
+            return dynamic_cast<PoolAllocator*>(allocator);
+        }
+
+        /**
+         * Writes the given string as a quoted JSON string.
+         */
+        void writeJsonString(std::ostream & stream, const std::string & string) {
+            stream << '"';
+            for (char c : string) {
+                if (c == '"' || c == '\\') {
+                    stream << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    stream << ' ';
+                } else {
+                    stream << c;
+                }
+            }
+            stream << '"';
+        }
+    }
+
     AllocationService::AllocationService()
-    : allocatorFactory([](const Type & t){
+    : id(NextAllocationServiceId++),
+    allocatorFactory([this](const Type & t){
         std::stringstream name;
         name << "[" << t.name() << "]";
-        return std::make_shared<PoolAllocator>(name.str(), t.size);
+        // Capacity hints are reserved by getOrCreateAllocator, so pages keep their default size.
+        return std::make_shared<PoolAllocator>(
+                name.str(),
+                t.size,
+                PoolAllocator::Index(PoolAllocator::GetDefaultCapacity()),
+                PoolAllocator::UnlimitedCapacity,
+                t.alignment);
     })
     {}
 
     AllocationService::~AllocationService() = default;
 
+    std::shared_lock<std::shared_mutex> AllocationService::lockForReading() const {
+        if (threadSafe) {
+            return std::shared_lock<std::shared_mutex>(allocatorsMutex);
+        }
+        return std::shared_lock<std::shared_mutex>();
+    }
+
+    std::unique_lock<std::shared_mutex> AllocationService::lockForWriting() const {
+        if (threadSafe) {
+            return std::unique_lock<std::shared_mutex>(allocatorsMutex);
+        }
+        return std::unique_lock<std::shared_mutex>();
+    }
+
     void AllocationService::setDefaultAllocatorFactory(const AllocatorFactory &factory) {
+        auto lock = lockForWriting();
         this->allocatorFactory = factory;
     }
 
+    void AllocationService::setThreadSafe(bool threadSafe) {
+        std::unique_lock<std::shared_mutex> lock(allocatorsMutex);
+        this->threadSafe = threadSafe;
+    }
+
+    bool AllocationService::isThreadSafe() const {
+        return threadSafe;
+    }
+
+    size_t AllocationService::capacityHintOf(const Type & type) const {
+        const auto it = capacityHints.find(type.name());
+        if (it != capacityHints.end()) {
+            return it->second;
+        }
+        return 0;
+    }
+
+    bool AllocationService::saveHighWaterMarks(const Path & path) const {
+        std::ofstream fileStream(path.c_str());
+        if (!fileStream) {
+            PAX_LOG(Log::Level::Error, "Could not write high-water marks to " << path << "!");
+            return false;
+        }
+
+        auto lock = lockForReading();
+        fileStream << "# Peak number of allocations per type\n";
+        for (const auto & entry : allocators) {
+            const size_t peak = entry.second->getPeakNumberOfAllocations();
+            if (peak > 0) {
+                fileStream << peak << " " << entry.first.name() << "\n";
+            }
+        }
+        return bool(fileStream);
+    }
+
+    TypeMap<AllocatorStatistics> AllocationService::getStatistics() const {
+        auto lock = lockForReading();
+        TypeMap<AllocatorStatistics> statistics;
+        for (const auto & entry : allocators) {
+            statistics[entry.first] = entry.second->getStatistics();
+        }
+        return statistics;
+    }
+
+    void AllocationService::writeStatistics(std::ostream & stream) const {
+        auto lock = lockForReading();
+        stream << "[";
+        bool first = true;
+        for (const auto & entry : allocators) {
+            const AllocatorStatistics statistics = entry.second->getStatistics();
+            stream << (first ? "\n" : ",\n") << "  {\"type\": ";
+            writeJsonString(stream, entry.first.name());
+            stream << ", \"allocator\": ";
+            writeJsonString(stream, entry.second->getName());
+            stream << ", \"liveObjects\": " << statistics.liveObjects
+                   << ", \"peakObjects\": " << statistics.peakObjects
+                   << ", \"totalAllocations\": " << statistics.totalAllocations
+                   << ", \"totalFrees\": " << statistics.totalFrees
+                   << ", \"spills\": " << statistics.spills
+                   << ", \"bytesReserved\": " << statistics.bytesReserved
+                   << ", \"bytesUsed\": " << statistics.bytesUsed
+                   << ", \"holeRatio\": " << statistics.holeRatio << "}";
+            first = false;
+        }
+        stream << "\n]\n";
+    }
+
+    bool AllocationService::saveStatistics(const Path & path) const {
+        std::ofstream fileStream(path.c_str());
+        if (!fileStream) {
+            PAX_LOG(Log::Level::Error, "Could not write allocator statistics to " << path << "!");
+            return false;
+        }
+
+        writeStatistics(fileStream);
+        return bool(fileStream);
+    }
+
+    bool AllocationService::loadHighWaterMarks(const Path & path) {
+        std::ifstream fileStream(path.c_str());
+        if (!fileStream) {
+            PAX_LOG(Log::Level::Warn, "Could not read high-water marks from " << path << "!");
+            return false;
+        }
+
+        auto lock = lockForWriting();
+        std::string line;
+        while (std::getline(fileStream, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            // The type name is the rest of the line as it might contain spaces.
+            std::stringstream lineStream(line);
+            size_t peak = 0;
+            std::string typeName;
+            if (lineStream >> peak && std::getline(lineStream >> std::ws, typeName) && peak > 0) {
+                capacityHints[typeName] = peak;
+            } else {
+                PAX_LOG(Log::Level::Warn, "Skipping malformed line \"" << line << "\" in high-water marks " << path << ".");
+            }
+        }
+        return true;
+    }
+
+    size_t AllocationService::getCapacityHintFor(const Type & type) const {
+        auto lock = lockForReading();
+        return capacityHintOf(type);
+    }
+
     void AllocationService::registerAllocator(const TypeId & type, const std::shared_ptr<Allocator> & allocator) {
+        auto lock = lockForWriting();
+        if (threadSafe) {
+            const auto existing = allocators.find(type);
+            if (existing != allocators.end()) {
+                retiredAllocators.push_back(existing->second);
+            }
+        }
         allocators.insert_or_assign(type, allocator);
+        ++version;
     }
 
     std::shared_ptr<Allocator> AllocationService::unregisterAllocator(const TypeId & type) {
+        auto lock = lockForWriting();
         auto iterator = allocators.find(type);
         if (iterator != allocators.end()) {
             std::shared_ptr<Allocator> elementToRemove = std::move(iterator->second);
             allocators.erase(iterator);
+            if (threadSafe) {
+                retiredAllocators.push_back(elementToRemove);
+            }
+            ++version;
             return elementToRemove;
         }
 
@@ -35,6 +222,7 @@ namespace PAX {
     }
 
     std::shared_ptr<Allocator> AllocationService::getAllocator(const TypeId &type) {
+        auto lock = lockForReading();
         auto iterator = allocators.find(type);
         if (iterator != allocators.end()) {
             return iterator->second;
@@ -43,33 +231,73 @@ namespace PAX {
         return nullptr;
     }
 
+    std::shared_ptr<Allocator> AllocationService::findAllocator(const TypeId & type) const {
+        auto lock = lockForReading();
+        const auto & it = allocators.find(type);
+        if (it != allocators.end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
     bool AllocationService::hasAllocated(const TypeId & t, void * object) const {
+        auto lock = lockForReading();
         const auto & it = allocators.find(t);
         return it != allocators.end() && it->second->isMine(object);
     }
 
-    void * AllocationService::allocate(const Type & t) {
-        std::shared_ptr<Allocator> allocator = nullptr;
+    std::shared_ptr<Allocator> AllocationService::getOrCreateAllocator(const Type & t) {
+        // Shares ownership such that concurrent (un)registrations cannot destroy the allocator while it is in use.
+        std::shared_ptr<Allocator> allocator = findAllocator(t.id);
 
-        const auto & allocIt = allocators.find(t.id);
-        if (allocIt != allocators.end()) {
+        // Create default allocator
+        if (!allocator) {
+            auto lock = lockForWriting();
+            // Another thread might have created the allocator in the meantime.
+            auto allocIt = allocators.find(t.id);
+            if (allocIt == allocators.end()) {
+                std::shared_ptr<Allocator> created = allocatorFactory(t);
+                // Factories do not know about capacity hints, so we reserve the memory ourselves.
+                if (PoolAllocator * pool = PoolOf(created.get())) {
+                    pool->reserve(pool->getNumberOfAllocations() + PoolAllocator::Index(capacityHintOf(t)));
+                }
+                if (threadSafe && !created->isThreadSafe()) {
+                    // Wrapping would guard each type on its own but all types of a size class share one pool.
+                    if (auto * sizeClassAllocator = dynamic_cast<SizeClassAllocator*>(created.get())) {
+                        PAX_THROW_RUNTIME_ERROR("Allocator " << sizeClassAllocator->getName() << " shares the size class " << sizeClassAllocator->getSizeClass()->getName() << " that is not thread-safe but the AllocationService is! Use SizeClassAllocator::CreateFactory(true) for thread-safe services.");
+                    }
+                    created = std::make_shared<ConcurrentAllocator>(created);
+                }
+                allocIt = allocators.emplace(t.id, created).first;
+            }
             allocator = allocIt->second;
+        }
 
-            if (allocator->getAllocationSize() != t.size) {
-                PAX_THROW_RUNTIME_ERROR("Allocator registered for type " << t.name() << " does not allocate data of size_t " << t.size << "!");
-            }
+        if (allocator->getAllocationSize() != t.size) {
+            PAX_THROW_RUNTIME_ERROR("Allocator registered for type " << t.name() << " does not allocate data of size_t " << t.size << "!");
         }
 
-        // Create default allocator
-        if (!allocator) {
-            allocator = allocatorFactory(t);
-            registerAllocator(t.id, allocator);
+        if (allocator->getAlignment() % t.alignment != 0) {
+            PAX_THROW_RUNTIME_ERROR("Allocator registered for type " << t.name() << " aligns data to " << allocator->getAlignment() << " bytes but the type requires an alignment of " << t.alignment << " bytes!");
         }
 
+        return allocator;
+    }
+
+    void * AllocationService::allocate(const Type & t) {
+        const std::shared_ptr<Allocator> allocator = getOrCreateAllocator(t);
         return allocator->allocate();
     }
 
+    std::vector<void*> AllocationService::allocateBatch(const Type & t, size_t n) {
+        std::vector<void*> memory(n);
+        const std::shared_ptr<Allocator> allocator = getOrCreateAllocator(t);
+        allocator->allocateN(n, memory.data());
+        return memory;
+    }
+
     bool AllocationService::free(const TypeId & type, void * object) {
+        auto lock = lockForReading();
         const auto& it = allocators.find(type);
         if (it == allocators.end()) {
             PAX_THROW_RUNTIME_ERROR("Cannot free \"" << object << "\" because there is no IAllocator registered for the given type \"" << type.name() << "\"!");
@@ -82,4 +310,89 @@ namespace PAX {
             PAX_THROW_RUNTIME_ERROR("Cannot free \"" << object << "\" because it was not allocated by the allocator \"" << allocator << "\" registered for the given type \"" << type.name() << "\" in this AllocationService!");
         }
     }
+
+    bool AllocationService::freeBatch(const TypeId & type, const std::vector<void*> & memory) {
+        auto lock = lockForReading();
+        const auto& it = allocators.find(type);
+        if (it == allocators.end()) {
+            PAX_THROW_RUNTIME_ERROR("Cannot free memory because there is no IAllocator registered for the given type \"" << type.name() << "\"!");
+        }
+
+        const auto & allocator = it->second;
+        for (void * object : memory) {
+            if (!allocator->isMine(object)) {
+                PAX_THROW_RUNTIME_ERROR("Cannot free \"" << object << "\" because it was not allocated by the allocator \"" << allocator << "\" registered for the given type \"" << type.name() << "\" in this AllocationService!");
+            }
+        }
+
+        return allocator->freeN(memory.data(), memory.size()) == memory.size();
+    }
+
+    void AllocationService::addDestructor(const TypeId & type, Destructor destructor) {
+        auto lock = lockForWriting();
+        destructors[type] = destructor;
+    }
+
+    bool AllocationService::destroyAll() {
+        std::vector<std::pair<PoolAllocator*, Destructor>> pools;
+        bool complete = true;
+
+        {
+            auto lock = lockForReading();
+            for (const auto & entry : allocators) {
+                Allocator * allocator = entry.second.get();
+                if (auto * concurrent = dynamic_cast<ConcurrentAllocator*>(allocator)) {
+                    concurrent->flush();
+                    allocator = concurrent->getBackend().get();
+                }
+
+                auto * pool = dynamic_cast<PoolAllocator*>(allocator);
+                if (!pool) {
+                    if (allocator->getStatistics().liveObjects > 0) {
+                        PAX_LOG(Log::Level::Warn, "Cannot destroy objects of " << entry.first.name() << " at once because allocator " << allocator->getName() << " is not a PoolAllocator!");
+                        complete = false;
+                    }
+                    continue;
+                }
+
+                const auto destructor = destructors.find(entry.first);
+                if (destructor == destructors.end()) {
+                    if (pool->getNumberOfAllocations() > 0) {
+                        PAX_LOG(Log::Level::Warn, "Freeing " << pool->getNumberOfAllocations() << " objects of " << entry.first.name() << " without destroying them because their destructor is unknown! Allocate them with allocate<T>() or call registerDestructor<T>().");
+                        complete = false;
+                    }
+                    pools.emplace_back(pool, nullptr);
+                } else {
+                    pools.emplace_back(pool, destructor->second);
+                }
+            }
+        }
+
+        // Destructors may query this service, so it must not be locked anymore.
+        destroyingAll = true;
+        for (const auto & entry : pools) {
+            PoolAllocator * pool = entry.first;
+            if (const Destructor destroy = entry.second) {
+                const PoolAllocator::Index end = pool->end();
+                for (PoolAllocator::Index i = pool->nextAllocated(pool->begin()); i < end; i = pool->nextAllocated(i + 1)) {
+                    destroy(pool->getData(i));
+                }
+            }
+        }
+        destroyingAll = false;
+
+        for (const auto & entry : pools) {
+            entry.first->freeAll();
+        }
+
+        return complete;
+    }
+
+    bool AllocationService::isDestroyingAll() const {
+        return destroyingAll;
+    }
+
+    PoolAllocator * AllocationService::getPoolAllocator(const TypeId & type) {
+        return PoolOf(getAllocator(type).get());
+    }
 }
\ No newline at end of file
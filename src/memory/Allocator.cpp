@@ -3,12 +3,47 @@
 //
 
 #include "polypropylene/memory/Allocator.h"
+#include <cstddef>
 
 namespace PAX {
     Allocator::Allocator(const std::string &name) : name(name) {}
 
     Allocator::~Allocator() = default;
 
+    void Allocator::allocateN(size_t count, void ** out) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = allocate();
+        }
+    }
+
+    size_t Allocator::freeN(void * const * data, size_t count) {
+        size_t freed = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (free(data[i])) {
+                ++freed;
+            }
+        }
+        return freed;
+    }
+
+    size_t Allocator::getAlignment() const {
+        return alignof(std::max_align_t);
+    }
+
+    bool Allocator::isThreadSafe() const {
+        return false;
+    }
+
+    size_t Allocator::getPeakNumberOfAllocations() const {
+        return 0;
+    }
+
+    AllocatorStatistics Allocator::getStatistics() const {
+        AllocatorStatistics statistics;
+        statistics.peakObjects = getPeakNumberOfAllocations();
+        return statistics;
+    }
+
     const std::string & Allocator::getName() const {
         return name;
     }
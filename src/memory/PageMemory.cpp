@@ -0,0 +1,101 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/memory/PageMemory.h"
+#include "polypropylene/definitions/OSDetection.h"
+#include <new>
+
+#if defined(PAX_OS_LINUX) || defined(PAX_OS_UNIX) || defined(PAX_OS_ANDROID)
+#define PAX_PAGEMEMORY_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace PAX {
+    namespace PageMemory {
+        size_t getSystemPageSize() {
+#ifdef PAX_PAGEMEMORY_MMAP
+            static const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+            return pageSize;
+#else
+            return 4096;
+#endif
+        }
+
+        bool isMapped(size_t bytes, size_t alignment) {
+#ifdef PAX_PAGEMEMORY_MMAP
+            // mmap returns memory aligned to system pages only.
+            return bytes >= getSystemPageSize() && alignment <= getSystemPageSize();
+#else
+            PAX_UNREFERENCED_PARAMETER(bytes)
+            PAX_UNREFERENCED_PARAMETER(alignment)
+            return false;
+#endif
+        }
+
+        void * allocate(size_t bytes, size_t alignment, bool hugePages) {
+#ifdef PAX_PAGEMEMORY_MMAP
+            if (isMapped(bytes, alignment)) {
+                // Anonymous mappings are committed page by page when they are touched for the first time.
+                void * block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (block == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                if (hugePages) {
+                    adviseHugePages(block, bytes, alignment, true);
+                }
+                return block;
+            }
+#else
+            PAX_UNREFERENCED_PARAMETER(hugePages)
+#endif
+            return ::operator new(bytes, std::align_val_t(alignment));
+        }
+
+        void free(void * block, size_t bytes, size_t alignment) {
+#ifdef PAX_PAGEMEMORY_MMAP
+            if (isMapped(bytes, alignment)) {
+                munmap(block, bytes);
+                return;
+            }
+#endif
+            ::operator delete(block, std::align_val_t(alignment));
+        }
+
+        void adviseHugePages(void * block, size_t bytes, size_t alignment, bool hugePages) {
+#if defined(PAX_PAGEMEMORY_MMAP) && defined(MADV_HUGEPAGE)
+            if (isMapped(bytes, alignment)) {
+                // This is only a hint, so failure (e.g., because transparent huge pages are disabled) is fine.
+                madvise(block, bytes, hugePages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+            }
+#else
+            PAX_UNREFERENCED_PARAMETER(block)
+            PAX_UNREFERENCED_PARAMETER(bytes)
+            PAX_UNREFERENCED_PARAMETER(alignment)
+            PAX_UNREFERENCED_PARAMETER(hugePages)
+#endif
+        }
+
+        size_t decommitTail(void * block, size_t bytes, size_t alignment, size_t offset) {
+#ifdef PAX_PAGEMEMORY_MMAP
+            if (isMapped(bytes, alignment)) {
+                const size_t pageSize = getSystemPageSize();
+                const size_t begin = (offset + pageSize - 1) & ~(pageSize - 1);
+                if (begin < bytes) {
+                    const size_t length = bytes - begin;
+                    if (madvise(static_cast<char*>(block) + begin, length, MADV_DONTNEED) == 0) {
+                        return length;
+                    }
+                }
+            }
+#else
+            PAX_UNREFERENCED_PARAMETER(block)
+            PAX_UNREFERENCED_PARAMETER(bytes)
+            PAX_UNREFERENCED_PARAMETER(alignment)
+            PAX_UNREFERENCED_PARAMETER(offset)
+#endif
+            return 0;
+        }
+    }
+}
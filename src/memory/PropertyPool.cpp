@@ -8,6 +8,6 @@ namespace PAX {
     PAX_MAYBEUNUSED bool DefaultChunkValidator::isValid(const PoolAllocator &pool, PoolAllocator::Index i) const {
         return
                 0 <= i && i < pool.getCapacity() &&
-                pool.getChunkInfo(i)->allocated;
+                pool.isAllocated(i);
     }
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/memory/allocators/ArenaAllocator.h"
+#include "polypropylene/log/Errors.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace PAX {
+    Arena::Arena(size_t blockSize) : blockSize(blockSize) {
+        if (blockSize == 0) {
+            PAX_THROW_RUNTIME_ERROR("Block size of arena has to be greater than 0!");
+        }
+    }
+
+    Arena::~Arena() {
+        reset();
+        for (const Block & block : blocks) {
+            ::operator delete(block.memory, std::align_val_t(alignof(std::max_align_t)));
+        }
+    }
+
+    size_t Arena::nextBlockFor(size_t size) {
+        size_t b = blocks.empty() ? 0 : currentBlock + 1;
+        while (b < blocks.size() && blocks[b].size < size) {
+            ++b;
+        }
+
+        if (b == blocks.size()) {
+            const size_t newBlockSize = std::max(blockSize, size);
+            blocks.push_back({static_cast<char*>(::operator new(newBlockSize, std::align_val_t(alignof(std::max_align_t)))), newBlockSize});
+        }
+
+        return b;
+    }
+
+    void * Arena::allocate(size_t size, size_t alignment) {
+        if (!blocks.empty()) {
+            const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(blocks[currentBlock].memory);
+            const std::uintptr_t aligned = (begin + offset + alignment - 1) & ~std::uintptr_t(alignment - 1);
+            const size_t newOffset = size_t(aligned - begin) + size;
+            if (newOffset <= blocks[currentBlock].size) {
+                offset = newOffset;
+                return reinterpret_cast<void*>(aligned);
+            }
+        }
+
+        // Blocks are aligned to alignof(std::max_align_t), so we reserve padding for stricter alignments only.
+        const size_t padding = alignment > alignof(std::max_align_t) ? alignment - 1 : 0;
+        currentBlock = nextBlockFor(size + padding);
+        offset = 0;
+        return allocate(size, alignment);
+    }
+
+    void Arena::reset() {
+        for (ArenaAllocator * allocator : destructingAllocators) {
+            allocator->destroyAll();
+        }
+
+        currentBlock = 0;
+        offset = 0;
+    }
+
+    bool Arena::contains(const void * data) const {
+        const char * c = static_cast<const char*>(data);
+        for (const Block & block : blocks) {
+            if (block.memory <= c && c < block.memory + block.size) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t Arena::getBytesUsed() const {
+        size_t bytes = offset;
+        for (size_t b = 0; b < currentBlock && b < blocks.size(); ++b) {
+            bytes += blocks[b].size;
+        }
+        return bytes;
+    }
+
+    size_t Arena::getNumberOfBlocks() const {
+        return blocks.size();
+    }
+
+    ArenaAllocator::ArenaAllocator(const std::string & name, size_t elementSize, size_t alignment, const std::shared_ptr<Arena> & arena, Destructor destructor) :
+    Allocator(name),
+    arena(arena),
+    elementSize(elementSize),
+    alignment(alignment),
+    destructor(destructor),
+    headerSize(destructor ? ((sizeof(size_t) + alignment - 1) & ~(alignment - 1)) : 0)
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            PAX_THROW_RUNTIME_ERROR("Invalid alignment for ArenaAllocator " << name << ": " << alignment << " is not a power of two!");
+        }
+
+        if (destructor) {
+            arena->destructingAllocators.push_back(this);
+        }
+    }
+
+    ArenaAllocator::~ArenaAllocator() {
+        if (destructor) {
+            destroyAll();
+            auto & allocators = arena->destructingAllocators;
+            allocators.erase(std::remove(allocators.begin(), allocators.end(), this), allocators.end());
+        }
+    }
+
+    void ArenaAllocator::destroyAll() {
+        // Destroy in reverse order of construction.
+        for (auto it = liveObjects.rbegin(); it != liveObjects.rend(); ++it) {
+            if (*it) {
+                destructor(*it);
+            }
+        }
+        liveObjects.clear();
+    }
+
+    void * ArenaAllocator::allocate() {
+        if (destructor) {
+            // The object starts after the header such that the index is stored directly in front of it.
+            char * data = static_cast<char*>(arena->allocate(headerSize + elementSize, alignment)) + headerSize;
+            const size_t index = liveObjects.size();
+            std::memcpy(data - sizeof(size_t), &index, sizeof(size_t));
+            liveObjects.push_back(data);
+            return data;
+        }
+
+        return arena->allocate(elementSize, alignment);
+    }
+
+    bool ArenaAllocator::free(void * data) {
+        if (destructor) {
+            char * object = static_cast<char*>(data);
+            if (!arena->contains(object) || !arena->contains(object - sizeof(size_t))) {
+                return false;
+            }
+
+            size_t index;
+            std::memcpy(&index, object - sizeof(size_t), sizeof(size_t));
+            // The header is only trustworthy if the list points back to the object.
+            if (index >= liveObjects.size() || liveObjects[index] != data) {
+                return false;
+            }
+
+            liveObjects[index] = nullptr;
+            return true;
+        }
+
+        return arena->contains(data);
+    }
+
+    bool ArenaAllocator::isMine(void * data) const {
+        return arena->contains(data);
+    }
+
+    size_t ArenaAllocator::getAlignment() const {
+        return alignment;
+    }
+
+    size_t ArenaAllocator::getAllocationSize() const {
+        return elementSize;
+    }
+
+    const std::shared_ptr<Arena> & ArenaAllocator::getArena() const {
+        return arena;
+    }
+}
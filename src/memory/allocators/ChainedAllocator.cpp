@@ -0,0 +1,117 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/memory/allocators/ChainedAllocator.h"
+#include "polypropylene/memory/allocators/SlabAllocator.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace PAX {
+    ChainedAllocator::ChainedAllocator(const std::shared_ptr<Allocator> & primary, const std::shared_ptr<Allocator> & secondary) :
+    Allocator(primary->getName()),
+    primary(primary),
+    secondary(secondary),
+    primaryPool(dynamic_cast<PoolAllocator*>(primary.get()))
+    {
+        if (secondary->getAllocationSize() < primary->getAllocationSize()) {
+            PAX_THROW_RUNTIME_ERROR("Secondary allocator " << secondary->getName() << " is too small to take over allocations of " << primary->getName() << "!");
+        }
+    }
+
+    bool ChainedAllocator::isPrimaryFull() const {
+        return primaryPool && primaryPool->isFull();
+    }
+
+    void * ChainedAllocator::allocate() {
+        if (!isPrimaryFull()) {
+            try {
+                return primary->allocate();
+            } catch (const std::runtime_error &) {
+                // The primary allocator is full. Fall through to the secondary one.
+            }
+        }
+
+        void * data = secondary->allocate();
+        spills.fetch_add(1, std::memory_order_relaxed);
+        return data;
+    }
+
+    void ChainedAllocator::allocateN(size_t count, void ** out) {
+        if (!primaryPool) {
+            Allocator::allocateN(count, out);
+            return;
+        }
+
+        const size_t fitting = std::min(count, primaryPool->getRemainingCapacity());
+        primary->allocateN(fitting, out);
+        if (fitting < count) {
+            secondary->allocateN(count - fitting, out + fitting);
+            spills.fetch_add(count - fitting, std::memory_order_relaxed);
+        }
+    }
+
+    bool ChainedAllocator::free(void * data) {
+        if (primary->isMine(data)) {
+            return primary->free(data);
+        }
+        if (secondary->isMine(data)) {
+            return secondary->free(data);
+        }
+        return false;
+    }
+
+    bool ChainedAllocator::isMine(void * data) const {
+        return primary->isMine(data) || secondary->isMine(data);
+    }
+
+    size_t ChainedAllocator::getAllocationSize() const {
+        return primary->getAllocationSize();
+    }
+
+    size_t ChainedAllocator::getAlignment() const {
+        return std::min(primary->getAlignment(), secondary->getAlignment());
+    }
+
+    bool ChainedAllocator::isThreadSafe() const {
+        return primary->isThreadSafe() && secondary->isThreadSafe();
+    }
+
+    size_t ChainedAllocator::getPeakNumberOfAllocations() const {
+        return primary->getPeakNumberOfAllocations() + secondary->getPeakNumberOfAllocations();
+    }
+
+    AllocatorStatistics ChainedAllocator::getStatistics() const {
+        AllocatorStatistics statistics = primary->getStatistics();
+        const AllocatorStatistics overflow = secondary->getStatistics();
+        statistics.liveObjects += overflow.liveObjects;
+        statistics.peakObjects += overflow.peakObjects;
+        statistics.totalAllocations += overflow.totalAllocations;
+        statistics.totalFrees += overflow.totalFrees;
+        statistics.bytesReserved += overflow.bytesReserved;
+        statistics.bytesUsed += overflow.bytesUsed;
+        statistics.spills += getNumberOfSpills();
+        return statistics;
+    }
+
+    uint64_t ChainedAllocator::getNumberOfSpills() const {
+        return spills.load(std::memory_order_relaxed);
+    }
+
+    const std::shared_ptr<Allocator> & ChainedAllocator::getPrimary() const {
+        return primary;
+    }
+
+    const std::shared_ptr<Allocator> & ChainedAllocator::getSecondary() const {
+        return secondary;
+    }
+
+    AllocationService::AllocatorFactory ChainedAllocator::CreateFactory(PoolAllocator::Index maxCapacity) {
+        return [maxCapacity](const Type & t) -> std::shared_ptr<Allocator> {
+            const PoolAllocator::Index pageCapacity = std::min(PoolAllocator::Index(PoolAllocator::GetDefaultCapacity()), maxCapacity);
+            return std::make_shared<ChainedAllocator>(
+                    std::make_shared<PoolAllocator>(t.name(), t.size, pageCapacity, maxCapacity, t.alignment),
+                    std::make_shared<SlabAllocator>(std::string(t.name()) + " (overflow)", t.size, t.alignment));
+        };
+    }
+}
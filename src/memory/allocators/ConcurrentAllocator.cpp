@@ -0,0 +1,246 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/memory/allocators/ConcurrentAllocator.h"
+#include "polypropylene/log/Errors.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+namespace PAX {
+    namespace {
+        std::atomic<uint64_t> NextConcurrentAllocatorId { 0 };
+
+        /**
+         * The magazines of the current thread by the id of their allocator.
+         * Magazines of destroyed allocators have expired and are pruned once the map grew enough.
+         */
+        thread_local std::unordered_map<uint64_t, std::weak_ptr<ConcurrentAllocator::Magazine>> LocalMagazines;
+        thread_local size_t LocalMagazinesPruneThreshold = 16;
+
+        /// Cache for the most recently used magazine of the current thread.
+        thread_local uint64_t LastMagazineOwner = ~uint64_t(0);
+        thread_local ConcurrentAllocator::Magazine * LastMagazine = nullptr;
+
+        void * nextOf(void * chunk) {
+            void * next;
+            std::memcpy(&next, chunk, sizeof(void*));
+            return next;
+        }
+
+        void setNextOf(void * chunk, void * next) {
+            std::memcpy(chunk, &next, sizeof(void*));
+        }
+    }
+
+    ConcurrentAllocator::ConcurrentAllocator(const std::shared_ptr<Allocator> & backend, size_t batchSize) :
+    Allocator(backend->getName()),
+    backend(backend),
+    batchSize(batchSize > 0 ? batchSize : 1),
+    id(NextConcurrentAllocatorId++)
+    {}
+
+    ConcurrentAllocator::~ConcurrentAllocator() {
+        flush();
+    }
+
+    ConcurrentAllocator::Magazine & ConcurrentAllocator::localMagazine() {
+        if (LastMagazineOwner == id) {
+            return *LastMagazine;
+        }
+
+        // Ids are never reused, so an entry for our id can only be empty if we did not create a magazine for this thread yet.
+        std::weak_ptr<Magazine> & entry = LocalMagazines[id];
+        Magazine * magazine = entry.lock().get();
+        if (!magazine) {
+            std::shared_ptr<Magazine> created = std::make_shared<Magazine>();
+            created->chunks.reserve(2 * batchSize);
+            magazine = created.get();
+            entry = created;
+            {
+                std::lock_guard<std::mutex> lock(magazinesMutex);
+                magazines.emplace_back(std::move(created));
+            }
+
+            // Drop the magazines of destroyed allocators.
+            if (LocalMagazines.size() >= LocalMagazinesPruneThreshold) {
+                for (auto it = LocalMagazines.begin(); it != LocalMagazines.end();) {
+                    it = it->second.expired() ? LocalMagazines.erase(it) : std::next(it);
+                }
+                LocalMagazinesPruneThreshold = std::max(size_t(16), 2 * LocalMagazines.size());
+            }
+        }
+
+        LastMagazineOwner = id;
+        LastMagazine = magazine;
+        return *magazine;
+    }
+
+    void ConcurrentAllocator::refill(Magazine & magazine) {
+        // Take all remotely freed chunks at once. Only pushing and taking the whole stack avoids ABA problems.
+        void * remote = remoteFrees.exchange(nullptr, std::memory_order_acquire);
+        while (remote && magazine.chunks.size() < 2 * batchSize) {
+            void * next = nextOf(remote);
+            magazine.chunks.push_back(remote);
+            remote = next;
+        }
+
+        if (remote || magazine.chunks.size() < batchSize) {
+            std::unique_lock<std::shared_mutex> lock(backendMutex);
+            // Remotely freed chunks that do not fit into the magazine anymore go back to the backend.
+            while (remote) {
+                void * next = nextOf(remote);
+                PAX_MAYBEUNUSED bool freed = backend->free(remote);
+                remote = next;
+            }
+
+            while (magazine.chunks.size() < batchSize) {
+                magazine.chunks.push_back(backend->allocate());
+            }
+        }
+    }
+
+    void ConcurrentAllocator::drainRemoteFreesToBackend() {
+        void * remote = remoteFrees.exchange(nullptr, std::memory_order_acquire);
+        while (remote) {
+            void * next = nextOf(remote);
+            PAX_MAYBEUNUSED bool freed = backend->free(remote);
+            remote = next;
+        }
+    }
+
+    void * ConcurrentAllocator::allocate() {
+        Magazine & magazine = localMagazine();
+        if (magazine.chunks.empty()) {
+            refill(magazine);
+        }
+
+        void * chunk = magazine.chunks.back();
+        magazine.chunks.pop_back();
+        PAX_ALLOCATOR_COUNT(magazine.allocations, 1)
+#ifdef PAX_BUILD_TYPE_DEBUG
+        {
+            std::lock_guard<std::mutex> lock(handedOutMutex);
+            handedOut.insert(chunk);
+        }
+#endif
+        return chunk;
+    }
+
+    void ConcurrentAllocator::allocateN(size_t count, void ** out) {
+        Magazine & magazine = localMagazine();
+        PAX_ALLOCATOR_COUNT(magazine.allocations, count)
+        size_t i = 0;
+        while (i < count && !magazine.chunks.empty()) {
+            out[i++] = magazine.chunks.back();
+            magazine.chunks.pop_back();
+        }
+
+        if (i < count) {
+            std::unique_lock<std::shared_mutex> lock(backendMutex);
+            backend->allocateN(count - i, out + i);
+        }
+
+#ifdef PAX_BUILD_TYPE_DEBUG
+        std::lock_guard<std::mutex> lock(handedOutMutex);
+        handedOut.insert(out, out + count);
+#endif
+    }
+
+    bool ConcurrentAllocator::free(void * data) {
+#ifdef PAX_BUILD_TYPE_DEBUG
+        // Chunks cached in magazines are allocated from the backend's point of view,
+        // so we have to remember ourselves which chunks are allocated.
+        if (!isMine(data)) {
+            PAX_LOG(Log::Level::Error, "Given pointer (" << data << ") was not allocated by ConcurrentAllocator " << getName() << "!");
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(handedOutMutex);
+            if (handedOut.erase(data) == 0) {
+                PAX_LOG(Log::Level::Warn, "Trying to free unallocated memory chunk in ConcurrentAllocator " << getName() << "! aborting...");
+                return false;
+            }
+        }
+#endif
+
+        Magazine & magazine = localMagazine();
+        PAX_ALLOCATOR_COUNT(magazine.frees, 1)
+        if (magazine.chunks.size() < 2 * batchSize) {
+            magazine.chunks.push_back(data);
+        } else if (getAllocationSize() >= sizeof(void*)) {
+            // Push onto the lock-free stack of remotely freed chunks.
+            void * head = remoteFrees.load(std::memory_order_relaxed);
+            do {
+                setNextOf(data, head);
+            } while (!remoteFrees.compare_exchange_weak(head, data, std::memory_order_release, std::memory_order_relaxed));
+        } else {
+            // The chunk is too small to link it into the remote stack.
+            std::unique_lock<std::shared_mutex> lock(backendMutex);
+            return backend->free(data);
+        }
+
+        return true;
+    }
+
+    bool ConcurrentAllocator::isMine(void * data) const {
+        std::shared_lock<std::shared_mutex> lock(backendMutex);
+        return backend->isMine(data);
+    }
+
+    size_t ConcurrentAllocator::getAllocationSize() const {
+        return backend->getAllocationSize();
+    }
+
+    size_t ConcurrentAllocator::getAlignment() const {
+        return backend->getAlignment();
+    }
+
+    bool ConcurrentAllocator::isThreadSafe() const {
+        return true;
+    }
+
+    size_t ConcurrentAllocator::getPeakNumberOfAllocations() const {
+        std::shared_lock<std::shared_mutex> lock(backendMutex);
+        return backend->getPeakNumberOfAllocations();
+    }
+
+    AllocatorStatistics ConcurrentAllocator::getStatistics() const {
+        AllocatorStatistics statistics;
+        {
+            std::shared_lock<std::shared_mutex> lock(backendMutex);
+            statistics = backend->getStatistics();
+        }
+#ifdef PAX_WITH_ALLOCATOR_STATISTICS
+        std::lock_guard<std::mutex> magazinesLock(magazinesMutex);
+        statistics.totalAllocations = 0;
+        statistics.totalFrees = 0;
+        for (const std::shared_ptr<Magazine> & magazine : magazines) {
+            statistics.totalAllocations += magazine->allocations.value.load(std::memory_order_relaxed);
+            statistics.totalFrees += magazine->frees.value.load(std::memory_order_relaxed);
+        }
+        // Frees may be counted before the corresponding allocations were read.
+        statistics.liveObjects = size_t(std::max(statistics.totalAllocations, statistics.totalFrees) - statistics.totalFrees);
+        statistics.bytesUsed = statistics.liveObjects * getAllocationSize();
+#endif
+        return statistics;
+    }
+
+    void ConcurrentAllocator::flush() {
+        std::lock_guard<std::mutex> magazinesLock(magazinesMutex);
+        std::unique_lock<std::shared_mutex> backendLock(backendMutex);
+        for (const std::shared_ptr<Magazine> & magazine : magazines) {
+            for (void * chunk : magazine->chunks) {
+                PAX_MAYBEUNUSED bool freed = backend->free(chunk);
+            }
+            magazine->chunks.clear();
+        }
+        drainRemoteFreesToBackend();
+    }
+
+    const std::shared_ptr<Allocator> & ConcurrentAllocator::getBackend() const {
+        return backend;
+    }
+}
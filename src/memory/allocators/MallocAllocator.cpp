@@ -3,23 +3,43 @@
 //
 
 #include <polypropylene/memory/allocators/MallocAllocator.h>
+#include "polypropylene/log/Errors.h"
+#include <algorithm>
+#include <cstddef>
+#include <new>
 
 namespace PAX {
-    MallocAllocator::MallocAllocator(const std::string & name, size_t elementSize) :
+    MallocAllocator::MallocAllocator(const std::string & name, size_t elementSize, size_t alignment) :
     Allocator(name),
-    elementSize(elementSize)
-    {}
+    elementSize(elementSize),
+    alignment(alignment > 0 ? alignment : alignof(std::max_align_t))
+    {
+        if ((this->alignment & (this->alignment - 1)) != 0) {
+            PAX_THROW_RUNTIME_ERROR("Invalid alignment for MallocAllocator " << name << ": " << this->alignment << " is not a power of two!");
+        }
+    }
+
+    bool MallocAllocator::isOverAligned() const {
+        return alignment > alignof(std::max_align_t);
+    }
 
     void * MallocAllocator::allocate() {
-        void * mem = malloc(elementSize);
+        void * mem = isOverAligned() ? ::operator new(elementSize, std::align_val_t(alignment)) : malloc(elementSize);
         allocatedObjects.insert(mem);
+        peakNumberOfAllocations = std::max(peakNumberOfAllocations, allocatedObjects.size());
+        PAX_ALLOCATOR_COUNT(totalAllocations, 1)
         return mem;
     }
 
     bool MallocAllocator::free(void * data) {
         if (isMine(data)) {
             allocatedObjects.erase(data);
-            ::free(data);
+            if (isOverAligned()) {
+                ::operator delete(data, std::align_val_t(alignment));
+            } else {
+                ::free(data);
+            }
+            PAX_ALLOCATOR_COUNT(totalFrees, 1)
             return true;
         }
         return false;
@@ -29,7 +49,26 @@ namespace PAX {
         return elementSize;
     }
 
+    size_t MallocAllocator::getAlignment() const {
+        return alignment;
+    }
+
     bool MallocAllocator::isMine(void *data) const {
         return allocatedObjects.find(data) != allocatedObjects.end();
     }
+
+    size_t MallocAllocator::getPeakNumberOfAllocations() const {
+        return peakNumberOfAllocations;
+    }
+
+    AllocatorStatistics MallocAllocator::getStatistics() const {
+        AllocatorStatistics statistics;
+        statistics.liveObjects = allocatedObjects.size();
+        statistics.peakObjects = peakNumberOfAllocations;
+        statistics.totalAllocations = totalAllocations;
+        statistics.totalFrees = totalFrees;
+        statistics.bytesReserved = allocatedObjects.size() * elementSize;
+        statistics.bytesUsed = statistics.bytesReserved;
+        return statistics;
+    }
 }
\ No newline at end of file
@@ -3,16 +3,19 @@
 //
 
 #include "polypropylene/memory/allocators/PoolAllocator.h"
+#include "polypropylene/memory/PageMemory.h"
 #include "polypropylene/log/Assert.h"
+#include "polypropylene/stdutils/BitUtils.h"
+#include <algorithm>
 
 namespace PAX {
 #ifdef PAX_BUILD_TYPE_DEBUG
     #define PAX_POOL_ASSERTVALIDINDEX(i) \
-        if ((i) < 0 || capacity <= (i)) { \
+        if ((i) < 0 || getCapacity() <= (i)) { \
             PAX_THROW_RUNTIME_ERROR("Index out of bounds in PoolAllocator " << getName() << ". Can be in [0, " << getCapacity() << "] but was " << (i) << "!"); \
         }
     #define PAX_POOL_ASSERTVALIDPOINTER(p) \
-        if (((p) - memory) % ChunkSize() != 0) { \
+        if (pageOf(p) < 0 || ((p) - pages[pageOf(p)]) % ChunkSize() != 0) { \
             PAX_THROW_RUNTIME_ERROR("Pointer out of bounds in PoolAllocator " << getName() << ".Given pointer " << (p) << " does not point to the beginning a valid data chunk!"); \
         }
 #else
@@ -23,103 +26,135 @@ namespace PAX {
     size_t PoolAllocator::DefaultCapacity = 1024;
 
     size_t PoolAllocator::ChunkSize() const {
-        return MetaDataSize + elementSize;
+        // Round up to the next multiple of alignment.
+        return (std::max(elementSize, size_t(1)) + alignment - 1) & ~(alignment - 1);
     }
 
-    size_t PoolAllocator::MemorySize() const {
-        return capacity * ChunkSize();
+    size_t PoolAllocator::PageSize() const {
+        return pageCapacity * ChunkSize();
     }
 
-    void * PoolAllocator::DataOf(ChunkInfo *chunk) {
-        return reinterpret_cast<memunit*>(chunk) + MetaDataSize;
+    PoolAllocator::Index PoolAllocator::pageOf(const void * data) const {
+        const memunit * m = static_cast<const memunit*>(data);
+        // Find the last page that starts at or before m.
+        auto it = std::upper_bound(pagesByAddress.begin(), pagesByAddress.end(), m,
+                                   [this](const memunit * m, Index page) { return m < pages[page]; });
+        if (it != pagesByAddress.begin()) {
+            const Index page = *(--it);
+            if (m < pages[page] + PageSize()) {
+                return page;
+            }
+        }
+        return -1;
     }
 
-    PoolAllocator::memunit * PoolAllocator::FromData(void *data) {
-        // The given pointer points to the data inside a ChunkInfo.
-        // DataOffset describes the byte offset of this data.
-        // Using it allows us to jump to the start of the ChunkInfo.
-        return reinterpret_cast<memunit*>(data) - MetaDataSize;
+    bool PoolAllocator::addPage() {
+        const Index capacity = getCapacity();
+        if (capacity > maxCapacity - pageCapacity) {
+            return false;
+        }
+
+        memunit * page = static_cast<memunit*>(PageMemory::allocate(PageSize(), alignment, hugePages));
+
+        const Index pageIndex = Index(pages.size());
+        pages.push_back(page);
+        pagesByAddress.insert(
+                std::upper_bound(pagesByAddress.begin(), pagesByAddress.end(), page,
+                                 [this](const memunit * m, Index p) { return m < pages[p]; }),
+                pageIndex);
+
+        freeChunks.resize(capacity + pageCapacity);
+        if (generations.size() < size_t(getCapacity())) {
+            generations.resize(size_t(getCapacity()), Generation(0));
+        }
+        return true;
     }
 
-    PoolAllocator::ChunkInfo * PoolAllocator::InfoFor(memunit *chunk) const {
-        PAX_POOL_ASSERTVALIDPOINTER(chunk)
-        return reinterpret_cast<ChunkInfo*>(chunk);
+    void PoolAllocator::removeLastPage() {
+        const Index pageIndex = Index(pages.size()) - 1;
+        freeChunks.resize(getCapacity() - pageCapacity);
+        pagesByAddress.erase(std::find(pagesByAddress.begin(), pagesByAddress.end(), pageIndex));
+        PageMemory::free(pages.back(), PageSize(), alignment);
+        pages.pop_back();
     }
 
     PoolAllocator::Index PoolAllocator::indexOf(const memunit * m) const {
         PAX_POOL_ASSERTVALIDPOINTER(m)
-        return Index((m - memory) / ChunkSize());
+        const Index page = pageOf(m);
+        return page * pageCapacity + Index((m - pages[page]) / ChunkSize());
     }
 
     PoolAllocator::memunit * PoolAllocator::memAtIndex(Index index) const {
         PAX_POOL_ASSERTVALIDINDEX(index)
-        return memory + size_t(index * ChunkSize());
+        return pages[index / pageCapacity] + size_t(index % pageCapacity) * ChunkSize();
     }
 
     void PoolAllocator::clearBounds() {
         firstElement = 0;
         lastElement = -1;
+        boundsAreTight = true;
     }
 
     void PoolAllocator::updateBoundsAfterDeletionOf(Index i) {
-        const bool isLastElement = i == lastElement;
-        if (i == firstElement) {
-            if (isLastElement) { // there was only one element allocated
-                // and now we are empty
-                clearBounds();
-            } else {
-                // go to the right and have a look who is the next allocated chunk
-                for (Index whoIsIt = i + 1; whoIsIt <= lastElement; ++whoIsIt) {
-                    if (getChunkInfo(whoIsIt)->allocated) {
-                        firstElement = whoIsIt;
-                        break;
-                    }
-                }
-                // If we did not find any other allocated chunk
-                // but we weren't the last element (because we are in the else branch)
-                if (i == firstElement) {
-                    // we had an illegal state
-                    PAX_THROW_RUNTIME_ERROR("Illegal state in PoolAllocator " << getName() << ". This is a bug. The bounds begin and end are invalid.");
-                }
-            }
-        } else if (isLastElement) {
-            // go from the last position to the left until we hit the next allocated chunk
-            for (Index whoIsIt = i - 1; whoIsIt >= firstElement; --whoIsIt) {
-                if (getChunkInfo(whoIsIt)->allocated) {
-                    lastElement = whoIsIt;
-                    break;
-                }
-            }
-            // If we did not find any other allocated chunk
-            // but we weren't the first element (because we are in the else branch)
-            if (i == lastElement) {
-                // we had an illegal state
+        if (numberOfAllocations == 0) {
+            clearBounds();
+        } else if (i == firstElement || i == lastElement) {
+            // The bounds still enclose all allocated chunks, but might not be tight anymore.
+            boundsAreTight = false;
+        }
+    }
+
+    void PoolAllocator::tightenBounds() const {
+        if (!boundsAreTight) {
+            firstElement = freeChunks.nextNotContained(firstElement);
+            lastElement = freeChunks.previousNotContained(lastElement);
+            if (lastElement < firstElement) {
                 PAX_THROW_RUNTIME_ERROR("Illegal state in PoolAllocator " << getName() << ". This is a bug. The bounds begin and end are invalid.");
             }
+            boundsAreTight = true;
         }
     }
 
-    PoolAllocator::PoolAllocator(const std::string & name, size_t elementSize, Index capacity) :
+    PoolAllocator::PoolAllocator(const std::string & name, size_t elementSize, Index pageCapacity, Index maxCapacity, size_t alignment) :
       Allocator(name),
       elementSize(elementSize),
-      capacity(capacity),
-      numberOfAllocations(0),
-      freeChunks(capacity)
+      alignment(alignment > 0 ? alignment : std::min(elementSize & (~elementSize + 1), alignof(std::max_align_t))),
+      pageCapacity(pageCapacity),
+      maxCapacity(maxCapacity),
+      numberOfAllocations(0)
     {
-        memory = new memunit[MemorySize()];
+        if (pageCapacity <= 0 || maxCapacity < pageCapacity) {
+            PAX_THROW_RUNTIME_ERROR("Invalid capacities for PoolAllocator " << name << ": page capacity is " << pageCapacity << " and maximum capacity is " << maxCapacity << "!");
+        }
+        if (this->alignment == 0 || (this->alignment & (this->alignment - 1)) != 0) {
+            PAX_THROW_RUNTIME_ERROR("Invalid alignment for PoolAllocator " << name << ": " << this->alignment << " is not a power of two!");
+        }
+
+        PAX_ASSERT(addPage());
         PAX_ASSERT(clear());
     }
 
     PoolAllocator::PoolAllocator(PAX::PoolAllocator && other) noexcept :
       Allocator(other.getName()),
+      freeChunks(std::move(other.freeChunks)),
       elementSize(other.elementSize),
-      capacity(other.capacity),
-      numberOfAllocations(other.numberOfAllocations),
-      memory(other.memory),
+      alignment(other.alignment),
+      pageCapacity(other.pageCapacity),
+      maxCapacity(other.maxCapacity),
       firstElement(other.firstElement),
       lastElement(other.lastElement),
-      freeChunks(std::move(other.freeChunks))
+      boundsAreTight(other.boundsAreTight),
+      pages(std::move(other.pages)),
+      pagesByAddress(std::move(other.pagesByAddress)),
+      generations(std::move(other.generations)),
+      epoch(other.epoch),
+      numberOfAllocations(other.numberOfAllocations),
+      peakNumberOfAllocations(other.peakNumberOfAllocations),
+      totalAllocations(other.totalAllocations),
+      totalFrees(other.totalFrees),
+      hugePages(other.hugePages)
     {
+        other.numberOfAllocations = 0;
     }
 
     PoolAllocator::~PoolAllocator() {
@@ -127,98 +162,289 @@ namespace PAX {
             PAX_LOG(PAX::Log::Level::Warn, "Deleting PoolAllocator " << getName() << " although there are still " << numberOfAllocations << " elements allocated!");
         }
 
-        delete[] memory;
+        for (memunit * page : pages) {
+            PageMemory::free(page, PageSize(), alignment);
+        }
     }
 
-    PoolAllocator::IndexStack::IndexStack(Index capacity) :
-      capacity(capacity),
-      topIndex(0)
-    {
-        stack = new Index[capacity];
+    PoolAllocator::FreeChunkSet::Word PoolAllocator::FreeChunkSet::allFree(size_t w) const {
+        const size_t remaining = size_t(capacity) - w * BitsPerWord;
+        return remaining >= size_t(BitsPerWord) ? ~Word(0) : (Word(1) << remaining) - 1;
     }
 
-    PoolAllocator::IndexStack::IndexStack(IndexStack && other) noexcept :
-      capacity(other.capacity),
-      topIndex(other.topIndex),
-      stack(other.stack)
-    {
+    PoolAllocator::FreeChunkSet::Word PoolAllocator::FreeChunkSet::word(size_t w) const {
+        return wordEpochs[w] == epoch ? words[w] : allFree(w);
+    }
 
+    PoolAllocator::FreeChunkSet::Word & PoolAllocator::FreeChunkSet::touch(size_t w) {
+        if (wordEpochs[w] != epoch) {
+            words[w] = allFree(w);
+            wordEpochs[w] = epoch;
+        }
+        return words[w];
     }
 
-    PoolAllocator::IndexStack::~IndexStack() {
-        delete[] stack;
+    void PoolAllocator::FreeChunkSet::fillSummary() {
+        const size_t numWords = words.size();
+        for (size_t s = 0; s < summary.size(); ++s) {
+            const size_t remaining = numWords - s * BitsPerWord;
+            summary[s] = remaining >= size_t(BitsPerWord) ? ~Word(0) : (Word(1) << remaining) - 1;
+        }
+        firstNonEmptySummaryWord = 0;
     }
 
-    PoolAllocator::Index PoolAllocator::IndexStack::pop() {
-        Index ret = stack[topIndex];
-        ++topIndex;
-        return ret;
+    PoolAllocator::Index PoolAllocator::FreeChunkSet::pop() {
+        // Skip all words that do not contain any free chunk.
+        while (summary[firstNonEmptySummaryWord] == 0) {
+            ++firstNonEmptySummaryWord;
+        }
+
+        const size_t w = firstNonEmptySummaryWord * BitsPerWord
+                + Util::countTrailingZeros(summary[firstNonEmptySummaryWord]);
+        Word & word = touch(w);
+        const Index i = Index(w * BitsPerWord + Util::countTrailingZeros(word));
+
+        word &= word - 1; // unset lowest bit
+        if (word == 0) {
+            summary[w / BitsPerWord] &= ~(Word(1) << (w % BitsPerWord));
+        }
+
+        --size;
+        return i;
     }
 
-    void PoolAllocator::IndexStack::push(Index val) {
-        if (full()) {
-            PAX_THROW_RUNTIME_ERROR("Memory overflow");
+    template<typename Consumer>
+    void PoolAllocator::FreeChunkSet::popN(Index count, Consumer && consume) {
+        Index taken = 0;
+        while (taken < count) {
+            while (summary[firstNonEmptySummaryWord] == 0) {
+                ++firstNonEmptySummaryWord;
+            }
+
+            const size_t w = firstNonEmptySummaryWord * BitsPerWord
+                    + Util::countTrailingZeros(summary[firstNonEmptySummaryWord]);
+            const Index wordBegin = Index(w * BitsPerWord);
+            Word word = touch(w);
+
+            if (word == ~Word(0) && count - taken >= BitsPerWord) {
+                // Fast path: The whole word is a contiguous run of free chunks.
+                for (Index i = 0; i < BitsPerWord; ++i) {
+                    consume(wordBegin + i);
+                }
+                taken += BitsPerWord;
+                word = 0;
+            } else {
+                while (word != 0 && taken < count) {
+                    consume(wordBegin + Index(Util::countTrailingZeros(word)));
+                    word &= word - 1; // unset lowest bit
+                    ++taken;
+                }
+            }
+
+            words[w] = word;
+            if (word == 0) {
+                summary[w / BitsPerWord] &= ~(Word(1) << (w % BitsPerWord));
+            }
         }
 
-        // Decrement the topIndex to make space for our new val.
-        --topIndex;
-        // Insert such that the stack is sorted and the smallest index stays at the stack top.
-        // Possible future optimisation:
-        // The stack needs not to be sorted. We only need the smallest element of the stack at the front.
-        Index posToInsertFreeIndex = topIndex;
-        while (stack[posToInsertFreeIndex + 1] < val) {
-            stack[posToInsertFreeIndex] = stack[posToInsertFreeIndex + 1];
-            ++posToInsertFreeIndex;
+        size -= count;
+    }
+
+    void PoolAllocator::FreeChunkSet::push(Index i) {
+        const size_t w = size_t(i) / BitsPerWord;
+        const size_t s = w / BitsPerWord;
+        touch(w) |= Word(1) << (size_t(i) % BitsPerWord);
+        summary[s] |= Word(1) << (w % BitsPerWord);
+        if (s < firstNonEmptySummaryWord) {
+            firstNonEmptySummaryWord = s;
         }
+        ++size;
+    }
 
-        stack[posToInsertFreeIndex] = val;
+    void PoolAllocator::FreeChunkSet::clear() {
+        // Initialise free chunks: All chunks are free now.
+        // Instead of setting the bits of all words, we outdate them.
+        ++epoch;
+        size = capacity;
+        fillSummary();
     }
 
-    void PoolAllocator::IndexStack::clear() {
-        // Initialise free chunks stack: All chunks are free now.
-        topIndex = 0;
-        for (Index i = 0; i < capacity; ++i) {
-            stack[i] = i;
+    void PoolAllocator::FreeChunkSet::resize(Index newCapacity) {
+        const size_t numWords = (size_t(newCapacity) + BitsPerWord - 1) / BitsPerWord;
+        const size_t numSummaryWords = (size_t(numWords) + BitsPerWord - 1) / BitsPerWord;
+        const Index oldCapacity = capacity;
+
+        // Outdated words are full up to the capacity.
+        // Thus, the last word has to be brought up to date before the capacity changes.
+        if (!words.empty()) {
+            touch(words.size() - 1);
+        }
+
+        // Drop all indices at and behind newCapacity.
+        for (Index i = newCapacity; i < oldCapacity; ++i) {
+            if (contains(i)) {
+                touch(size_t(i) / BitsPerWord) &= ~(Word(1) << (size_t(i) % BitsPerWord));
+                --size;
+            }
+        }
+
+        words.resize(numWords, Word(0));
+        wordEpochs.resize(numWords, epoch);
+        summary.resize(numSummaryWords, Word(0));
+        capacity = newCapacity;
+
+        if (newCapacity < oldCapacity) {
+            // Drop summary bits of words that were removed or became empty.
+            if (numWords > 0 && word(numWords - 1) == 0) {
+                summary.back() &= ~(Word(1) << ((numWords - 1) % BitsPerWord));
+            }
+            if (numWords % BitsPerWord != 0) {
+                summary.back() &= ~(~Word(0) << (numWords % BitsPerWord));
+            }
+            firstNonEmptySummaryWord = std::min(firstNonEmptySummaryWord, numSummaryWords);
+        } else {
+            for (Index i = oldCapacity; i < newCapacity; ++i) {
+                push(i);
+            }
         }
     }
 
-    bool PoolAllocator::IndexStack::empty() const {
-        return topIndex >= capacity;
+    bool PoolAllocator::FreeChunkSet::contains(Index i) const {
+        return (word(size_t(i) / BitsPerWord) >> (size_t(i) % BitsPerWord)) & Word(1);
     }
 
-    bool PoolAllocator::IndexStack::full() const {
-        return topIndex <= 0;
+    bool PoolAllocator::FreeChunkSet::empty() const {
+        return size == 0;
+    }
+
+    PoolAllocator::Index PoolAllocator::FreeChunkSet::getSize() const {
+        return size;
+    }
+
+    PoolAllocator::Index PoolAllocator::FreeChunkSet::nextNotContained(Index from) const {
+        if (from < 0) {
+            from = 0;
+        }
+
+        size_t w = size_t(from) / BitsPerWord;
+        if (w >= words.size()) {
+            return capacity;
+        }
+
+        // Bits of chunks that are not free, ignoring all bits before 'from'.
+        Word notFree = ~word(w) & (~Word(0) << (size_t(from) % BitsPerWord));
+        while (notFree == 0) {
+            if (++w >= words.size()) {
+                return capacity;
+            }
+            notFree = ~word(w);
+        }
+
+        return std::min(Index(w * BitsPerWord + Util::countTrailingZeros(notFree)), capacity);
+    }
+
+    PoolAllocator::Index PoolAllocator::FreeChunkSet::previousNotContained(Index from) const {
+        if (from >= capacity) {
+            from = capacity - 1;
+        }
+        if (from < 0) {
+            return -1;
+        }
+
+        size_t w = size_t(from) / BitsPerWord;
+        // Bits of chunks that are not free, ignoring all bits behind 'from'.
+        Word notFree = ~word(w) & (~Word(0) >> (BitsPerWord - 1 - size_t(from) % BitsPerWord));
+        while (notFree == 0) {
+            if (w == 0) {
+                return -1;
+            }
+            notFree = ~word(--w);
+        }
+
+        return Index(w * BitsPerWord + (BitsPerWord - 1 - Util::countLeadingZeros(notFree)));
     }
 
     void * PoolAllocator::allocate() {
+        if (freeChunks.empty()) {
+            addPage();
+        }
+
         if (!freeChunks.empty()) {
             ++numberOfAllocations;
+            peakNumberOfAllocations = std::max(peakNumberOfAllocations, numberOfAllocations);
+            PAX_ALLOCATOR_COUNT(totalAllocations, 1)
             Index indexOfNewElement = freeChunks.pop();
-            ChunkInfo * ourChunkInfo = getChunkInfo(indexOfNewElement);
-            ourChunkInfo->allocated = true;
-            if (indexOfNewElement < firstElement) {
+            if (numberOfAllocations == 1) {
                 firstElement = indexOfNewElement;
-            }
-            if (indexOfNewElement > lastElement) {
                 lastElement = indexOfNewElement;
+                boundsAreTight = true;
+            } else {
+                // The bounds only widen here, so they stay tight if they were tight before.
+                if (indexOfNewElement < firstElement) {
+                    firstElement = indexOfNewElement;
+                }
+                if (indexOfNewElement > lastElement) {
+                    lastElement = indexOfNewElement;
+                }
             }
-            return DataOf(ourChunkInfo);
+            return memAtIndex(indexOfNewElement);
         } else {
             PAX_THROW_RUNTIME_ERROR("Memory overflow in PoolAllocator " << getName() << "!");
         }
     }
 
-    bool PoolAllocator::free(void *data) noexcept {
-        memunit * mem = FromData(data);
-        const Index i = indexOf(mem);
+    void PoolAllocator::allocateN(size_t count, void ** out) {
+        if (count == 0) {
+            return;
+        }
+
+        if (size_t(numberOfAllocations) + count <= size_t(maxCapacity)) {
+            reserve(numberOfAllocations + Index(count));
+        }
+        if (size_t(freeChunks.getSize()) < count) {
+            PAX_THROW_RUNTIME_ERROR("Memory overflow in PoolAllocator " << getName() << "!");
+        }
+
+        Index first = -1;
+        Index last = -1;
+        size_t i = 0;
+        freeChunks.popN(Index(count), [this, out, &i, &first, &last](Index index) {
+            out[i++] = memAtIndex(index);
+            if (first < 0) {
+                first = index;
+            }
+            last = index;
+        });
+
+        // Indices are popped in ascending order.
+        if (numberOfAllocations == 0) {
+            firstElement = first;
+            lastElement = last;
+            boundsAreTight = true;
+        } else {
+            firstElement = std::min(firstElement, first);
+            lastElement = std::max(lastElement, last);
+        }
 
-        if (0 <= i && i < capacity) {
-            ChunkInfo * chunkToFree = InfoFor(mem);
-            if (chunkToFree->allocated) {
-                chunkToFree->allocated = false;
+        numberOfAllocations += Index(count);
+        peakNumberOfAllocations = std::max(peakNumberOfAllocations, numberOfAllocations);
+        PAX_ALLOCATOR_COUNT(totalAllocations, count)
+    }
+
+    bool PoolAllocator::free(void *data) noexcept {
+        const Index page = pageOf(data);
+
+        if (page >= 0) {
+            const size_t offset = size_t(static_cast<memunit*>(data) - pages[page]);
+            const Index i = page * pageCapacity + Index(offset / ChunkSize());
+            if (offset % ChunkSize() != 0) {
+                PAX_LOG(PAX::Log::Level::Error, "Given pointer (" << data << ") does not point to the beginning of a data chunk in PoolAllocator " << getName() << "!");
+            } else if (!freeChunks.contains(i)) {
                 --numberOfAllocations;
-                updateBoundsAfterDeletionOf(i);
+                PAX_ALLOCATOR_COUNT(totalFrees, 1)
+                ++generations[size_t(i)];
                 freeChunks.push(i);
+                updateBoundsAfterDeletionOf(i);
                 return true;
             } else {
                 PAX_LOG(PAX::Log::Level::Warn, "Trying to free unallocated memory chunk in PoolAllocator " << getName() << "! aborting...");
@@ -233,17 +459,18 @@ namespace PAX {
     }
 
     bool PoolAllocator::isMine(void *data) const {
-        // +1 to point to the end of the last data chunk = the begin of the first chunk behind our memory.
-        void * end = static_cast<void*>(memory + MemorySize() + 1);
-        return memory <= data && data < end;
+        return pageOf(data) >= 0;
     }
 
     bool PoolAllocator::clear() {
         if (numberOfAllocations == 0) {
-            // Null memory. (Thereby set allocated to false in all chunks).
-            memset(memory, 0, MemorySize());
+            while (pages.size() > 1) {
+                removeLastPage();
+            }
+
             freeChunks.clear();
             clearBounds();
+            PageMemory::decommitTail(pages.front(), PageSize(), alignment, 0);
             return true;
         } else {
             PAX_LOG(PAX::Log::Level::Error, "Clearing PoolAllocator " << getName() << " although there are still " << numberOfAllocations << " elements allocated");
@@ -251,29 +478,179 @@ namespace PAX {
         return false;
     }
 
+    void PoolAllocator::freeAll() {
+        if (numberOfAllocations == 0) {
+            return;
+        }
+
+        // Invalidate handles to all chunks without touching their generations.
+        ++epoch;
+
+        PAX_ALLOCATOR_COUNT(totalFrees, numberOfAllocations)
+        numberOfAllocations = 0;
+        freeChunks.clear();
+        clearBounds();
+    }
+
+    void PoolAllocator::reserve(Index capacity) {
+        while (getCapacity() < capacity && addPage()) {}
+    }
+
+    size_t PoolAllocator::shrink() {
+        const size_t pagesInUse = std::max(size_t(end() + pageCapacity - 1) / pageCapacity, size_t(1));
+        size_t released = 0;
+        while (pages.size() > pagesInUse) {
+            removeLastPage();
+            ++released;
+        }
+
+        // Give the memory behind the free chunks at the end of the last page back to the operating system.
+        const size_t usedChunksInLastPage = size_t(end()) - (pagesInUse - 1) * size_t(pageCapacity);
+        PageMemory::decommitTail(pages.back(), PageSize(), alignment, usedChunksInLastPage * ChunkSize());
+        return released;
+    }
+
+    size_t PoolAllocator::compact(const Relocator & relocate, std::chrono::nanoseconds budget) {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point start = Clock::now();
+        size_t moved = 0;
+
+        while (!isCompact()) {
+            const Index from = end() - 1;
+            // The pool is not compact, so there is a free chunk in front of the last allocated one.
+            const Index to = freeChunks.pop();
+
+            try {
+                relocate(memAtIndex(from), memAtIndex(to));
+            } catch (...) {
+                freeChunks.push(to);
+                throw;
+            }
+
+            firstElement = std::min(firstElement, to);
+            ++generations[size_t(from)];
+            freeChunks.push(from);
+            updateBoundsAfterDeletionOf(from);
+            ++moved;
+
+            if (Clock::now() - start >= budget) {
+                break;
+            }
+        }
+
+        return moved;
+    }
+
+    bool PoolAllocator::isCompact() const {
+        return end() <= numberOfAllocations;
+    }
+
     size_t PoolAllocator::getAllocationSize() const {
         return elementSize;
     }
 
-    PoolAllocator::ChunkInfo * PoolAllocator::getChunkInfo(Index index) const {
+    size_t PoolAllocator::getAlignment() const {
+        return alignment;
+    }
+
+    bool PoolAllocator::isAllocated(Index index) const {
         PAX_POOL_ASSERTVALIDINDEX(index)
-        return InfoFor(memAtIndex(index));
+        return !freeChunks.contains(index);
+    }
+
+    PoolAllocator::Index PoolAllocator::nextAllocated(Index from) const {
+        return std::min(freeChunks.nextNotContained(from), end());
+    }
+
+    PoolAllocator::Index PoolAllocator::getIndexOf(const void * data) const {
+        if (pageOf(data) < 0) {
+            return -1;
+        }
+        return indexOf(static_cast<const memunit*>(data));
     }
 
     void * PoolAllocator::getData(Index index) const {
         PAX_POOL_ASSERTVALIDINDEX(index)
-        return DataOf(getChunkInfo(index));
+        return memAtIndex(index);
     }
 
     PoolAllocator::Index PoolAllocator::getCapacity() const {
-        return capacity;
+        return Index(pages.size()) * pageCapacity;
+    }
+
+    PoolAllocator::Index PoolAllocator::getPageCapacity() const {
+        return pageCapacity;
+    }
+
+    size_t PoolAllocator::getNumberOfPages() const {
+        return pages.size();
+    }
+
+    AllocatorStatistics PoolAllocator::getStatistics() const {
+        AllocatorStatistics statistics;
+        statistics.liveObjects = size_t(numberOfAllocations);
+        statistics.peakObjects = size_t(peakNumberOfAllocations);
+        statistics.totalAllocations = totalAllocations;
+        statistics.totalFrees = totalFrees;
+        statistics.bytesReserved = pages.size() * PageSize();
+        statistics.bytesUsed = size_t(numberOfAllocations) * elementSize;
+        // Statistics may be queried under a shared lock, so we compute the tight bounds without storing them.
+        if (numberOfAllocations > 0) {
+            Index first = firstElement;
+            Index last = lastElement;
+            if (!boundsAreTight) {
+                first = freeChunks.nextNotContained(first);
+                last = freeChunks.previousNotContained(last);
+            }
+            const Index span = last + 1 - first;
+            if (span > 0) {
+                statistics.holeRatio = double(span - numberOfAllocations) / double(span);
+            }
+        }
+        return statistics;
+    }
+
+    void PoolAllocator::setHugePages(bool enabled) {
+        hugePages = enabled;
+        for (memunit * page : pages) {
+            PageMemory::adviseHugePages(page, PageSize(), alignment, enabled);
+        }
+    }
+
+    bool PoolAllocator::usesHugePages() const {
+        return hugePages;
+    }
+
+    PoolAllocator::Index PoolAllocator::getMaxCapacity() const {
+        return maxCapacity;
+    }
+
+    size_t PoolAllocator::getRemainingCapacity() const {
+        // Pages are only added as long as they fit completely (@ref addPage).
+        const Index capacity = getCapacity();
+        const size_t addablePages = size_t(maxCapacity - capacity) / size_t(pageCapacity);
+        return size_t(capacity - numberOfAllocations) + addablePages * size_t(pageCapacity);
+    }
+
+    bool PoolAllocator::isFull() const {
+        return getRemainingCapacity() == 0;
+    }
+
+    PoolAllocator::Index PoolAllocator::getNumberOfAllocations() const {
+        return numberOfAllocations;
+    }
+
+    size_t PoolAllocator::getPeakNumberOfAllocations() const {
+        return size_t(peakNumberOfAllocations);
     }
 
     PoolAllocator::Index PoolAllocator::begin() const {
+        tightenBounds();
         return firstElement;
     }
 
     PoolAllocator::Index PoolAllocator::end() const {
+        tightenBounds();
         // by C++ standard convention, end is supposed to point one behind the last valid element
         return lastElement + 1;
     }
@@ -0,0 +1,131 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/memory/allocators/SizeClassAllocator.h"
+#include "polypropylene/memory/allocators/ConcurrentAllocator.h"
+#include "polypropylene/stdutils/BitUtils.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace PAX {
+    SizeClassAllocator::SizeClassAllocator(const std::string & name, size_t elementSize, const std::shared_ptr<Allocator> & sizeClass) :
+    Allocator(name),
+    elementSize(elementSize),
+    sizeClass(sizeClass)
+    {
+        if (sizeClass->getAllocationSize() < elementSize) {
+            PAX_THROW_RUNTIME_ERROR("Size class " << sizeClass->getName() << " is too small for objects of " << name << " with size " << elementSize << "!");
+        }
+    }
+
+    void SizeClassAllocator::countAllocations(size_t count) {
+        PAX_ALLOCATOR_COUNT(totalAllocations, count)
+        const size_t allocations = numberOfAllocations += count;
+        size_t peak = peakNumberOfAllocations.load(std::memory_order_relaxed);
+        while (peak < allocations && !peakNumberOfAllocations.compare_exchange_weak(peak, allocations, std::memory_order_relaxed)) {}
+    }
+
+    void * SizeClassAllocator::allocate() {
+        void * data = sizeClass->allocate();
+        countAllocations(1);
+        return data;
+    }
+
+    void SizeClassAllocator::allocateN(size_t count, void ** out) {
+        sizeClass->allocateN(count, out);
+        countAllocations(count);
+    }
+
+    size_t SizeClassAllocator::freeN(void * const * data, size_t count) {
+        const size_t freed = sizeClass->freeN(data, count);
+        numberOfAllocations -= freed;
+        PAX_ALLOCATOR_COUNT(totalFrees, freed)
+        return freed;
+    }
+
+    bool SizeClassAllocator::free(void * data) {
+        if (sizeClass->free(data)) {
+            --numberOfAllocations;
+            PAX_ALLOCATOR_COUNT(totalFrees, 1)
+            return true;
+        }
+        return false;
+    }
+
+    bool SizeClassAllocator::isMine(void * data) const {
+        return sizeClass->isMine(data);
+    }
+
+    size_t SizeClassAllocator::getAllocationSize() const {
+        return elementSize;
+    }
+
+    size_t SizeClassAllocator::getAlignment() const {
+        return sizeClass->getAlignment();
+    }
+
+    bool SizeClassAllocator::isThreadSafe() const {
+        return sizeClass->isThreadSafe();
+    }
+
+    size_t SizeClassAllocator::getPeakNumberOfAllocations() const {
+        return peakNumberOfAllocations.load(std::memory_order_relaxed);
+    }
+
+    AllocatorStatistics SizeClassAllocator::getStatistics() const {
+        const AllocatorStatistics shared = sizeClass->getStatistics();
+        AllocatorStatistics statistics;
+        statistics.liveObjects = numberOfAllocations.load(std::memory_order_relaxed);
+        statistics.peakObjects = peakNumberOfAllocations.load(std::memory_order_relaxed);
+        statistics.totalAllocations = totalAllocations.load(std::memory_order_relaxed);
+        statistics.totalFrees = totalFrees.load(std::memory_order_relaxed);
+        statistics.bytesReserved = shared.bytesReserved;
+        statistics.bytesUsed = statistics.liveObjects * elementSize;
+        statistics.holeRatio = shared.holeRatio;
+        return statistics;
+    }
+
+    const std::shared_ptr<Allocator> & SizeClassAllocator::getSizeClass() const {
+        return sizeClass;
+    }
+
+    size_t SizeClassAllocator::SizeClassOf(size_t elementSize) {
+        if (elementSize <= MinimumSizeClass) {
+            return MinimumSizeClass;
+        }
+        // Round up to the next power of two.
+        return size_t(1) << (64u - Util::countLeadingZeros(uint64_t(elementSize - 1)));
+    }
+
+    AllocationService::AllocatorFactory SizeClassAllocator::CreateFactory(bool threadSafe, PoolAllocator::Index pageCapacity) {
+        // Size classes are identified by their size and alignment.
+        auto sizeClasses = std::make_shared<std::map<std::pair<size_t, size_t>, std::shared_ptr<Allocator>>>();
+
+        return [sizeClasses, threadSafe, pageCapacity](const Type & t) {
+            const size_t classSize = SizeClassOf(t.size);
+            // As class sizes are powers of two, chunks are naturally aligned to their size up to alignof(std::max_align_t).
+            // Only over-aligned types need a size class of their own.
+            const size_t alignment = std::max(t.alignment, std::min(classSize, alignof(std::max_align_t)));
+
+            std::shared_ptr<Allocator> & sizeClass = (*sizeClasses)[{classSize, alignment}];
+            if (!sizeClass) {
+                std::stringstream className;
+                className << "[SizeClass " << classSize;
+                if (alignment > alignof(std::max_align_t)) {
+                    className << " aligned to " << alignment;
+                }
+                className << "]";
+                sizeClass = std::make_shared<PoolAllocator>(className.str(), classSize, pageCapacity, PoolAllocator::UnlimitedCapacity, alignment);
+                if (threadSafe) {
+                    sizeClass = std::make_shared<ConcurrentAllocator>(sizeClass);
+                }
+            }
+
+            std::stringstream name;
+            name << "[" << t.name() << "]";
+            return std::make_shared<SizeClassAllocator>(name.str(), t.size, sizeClass);
+        };
+    }
+}
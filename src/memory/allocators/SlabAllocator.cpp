@@ -0,0 +1,139 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/memory/allocators/SlabAllocator.h"
+#include "polypropylene/memory/PageMemory.h"
+#include "polypropylene/log/Errors.h"
+#include <algorithm>
+#include <cstring>
+
+namespace PAX {
+    namespace {
+        /**
+         * @return The alignment of chunks for objects of the given size and requested alignment.
+         *         Each chunk has to be able to hold a pointer to the next free chunk.
+         */
+        size_t ChunkAlignmentOf(size_t elementSize, size_t alignment) {
+            if (alignment == 0) {
+                alignment = std::min(elementSize & (~elementSize + 1), alignof(std::max_align_t));
+            }
+            return std::max(alignment, alignof(void*));
+        }
+    }
+
+    SlabAllocator::SlabAllocator(const std::string & name, size_t elementSize, size_t alignment) :
+    Allocator(name),
+    elementSize(elementSize),
+    alignment(ChunkAlignmentOf(elementSize, alignment)),
+    // Round up to the next multiple of alignment.
+    chunkSize((std::max(elementSize, sizeof(void*)) + this->alignment - 1) & ~(this->alignment - 1)),
+    nextSlabSize(MinSlabSize)
+    {
+        if ((this->alignment & (this->alignment - 1)) != 0) {
+            PAX_THROW_RUNTIME_ERROR("Invalid alignment for SlabAllocator " << name << ": " << this->alignment << " is not a power of two!");
+        }
+    }
+
+    SlabAllocator::~SlabAllocator() {
+        if (numberOfAllocations > 0) {
+            PAX_LOG(PAX::Log::Level::Warn, "Deleting SlabAllocator " << getName() << " although there are still " << numberOfAllocations << " elements allocated!");
+        }
+
+        for (const Slab & slab : slabs) {
+            PageMemory::free(slab.memory, slab.size, alignment);
+        }
+    }
+
+    void SlabAllocator::addSlab() {
+        // Each slab holds at least one chunk.
+        const size_t size = std::max(nextSlabSize, chunkSize);
+        Slab slab { static_cast<char*>(PageMemory::allocate(size, alignment)), size };
+        slabs.insert(std::upper_bound(slabs.begin(), slabs.end(), slab.memory,
+                                      [](const char * m, const Slab & s) { return m < s.memory; }),
+                     slab);
+        nextSlabSize = std::min(2 * nextSlabSize, MaxSlabSize);
+
+        unused = slab.memory;
+        unusedEnd = slab.memory + (size / chunkSize) * chunkSize;
+    }
+
+    const SlabAllocator::Slab * SlabAllocator::slabOf(const void * data) const {
+        const char * m = static_cast<const char*>(data);
+        // Find the last slab that starts at or before m.
+        auto it = std::upper_bound(slabs.begin(), slabs.end(), m,
+                                   [](const char * m, const Slab & s) { return m < s.memory; });
+        if (it != slabs.begin()) {
+            --it;
+            if (m < it->memory + it->size) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    void * SlabAllocator::allocate() {
+        void * chunk;
+        if (freeList) {
+            chunk = freeList;
+            std::memcpy(&freeList, chunk, sizeof(void*));
+        } else {
+            if (unused == unusedEnd) {
+                addSlab();
+            }
+            chunk = unused;
+            unused += chunkSize;
+        }
+
+        ++numberOfAllocations;
+        peakNumberOfAllocations = std::max(peakNumberOfAllocations, numberOfAllocations);
+        PAX_ALLOCATOR_COUNT(totalAllocations, 1)
+        return chunk;
+    }
+
+    bool SlabAllocator::free(void * data) {
+        const Slab * slab = slabOf(data);
+        if (!slab || size_t(static_cast<char*>(data) - slab->memory) % chunkSize != 0) {
+            return false;
+        }
+
+        std::memcpy(data, &freeList, sizeof(void*));
+        freeList = data;
+        --numberOfAllocations;
+        PAX_ALLOCATOR_COUNT(totalFrees, 1)
+        return true;
+    }
+
+    bool SlabAllocator::isMine(void * data) const {
+        return slabOf(data) != nullptr;
+    }
+
+    size_t SlabAllocator::getAlignment() const {
+        return alignment;
+    }
+
+    size_t SlabAllocator::getAllocationSize() const {
+        return elementSize;
+    }
+
+    size_t SlabAllocator::getPeakNumberOfAllocations() const {
+        return peakNumberOfAllocations;
+    }
+
+    AllocatorStatistics SlabAllocator::getStatistics() const {
+        AllocatorStatistics statistics;
+        statistics.liveObjects = numberOfAllocations;
+        statistics.peakObjects = peakNumberOfAllocations;
+        statistics.totalAllocations = totalAllocations;
+        statistics.totalFrees = totalFrees;
+        for (const Slab & slab : slabs) {
+            statistics.bytesReserved += slab.size;
+        }
+        statistics.bytesUsed = numberOfAllocations * elementSize;
+        return statistics;
+    }
+
+    size_t SlabAllocator::getNumberOfSlabs() const {
+        return slabs.size();
+    }
+}
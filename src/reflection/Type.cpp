@@ -5,8 +5,14 @@
 #include "polypropylene/reflection/Type.h"
 
 namespace PAX {
-    Type::Type(const TypeId & type, size_t size) : id(type), size(size) {
-
+    Type::Type(const TypeId & type, size_t size, size_t alignment) : id(type), size(size), alignment(alignment) {
+        if (this->alignment == 0) {
+            // The greatest power of two dividing size is the natural alignment of an array of such objects.
+            this->alignment = size > 0 ? (size & (~size + 1)) : 1;
+            if (this->alignment > alignof(std::max_align_t)) {
+                this->alignment = alignof(std::max_align_t);
+            }
+        }
     }
 
     const char * Type::name() const noexcept {
@@ -18,7 +24,7 @@ namespace PAX {
     }
 
     bool Type::operator==(const Type & other) const noexcept {
-        return this->id == other.id && this->size == other.size;
+        return this->id == other.id && this->size == other.size && this->alignment == other.alignment;
     }
 
     Type::operator TypeId() const noexcept {
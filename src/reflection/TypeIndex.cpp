@@ -0,0 +1,73 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "polypropylene/reflection/TypeIndex.h"
+#include "polypropylene/log/Errors.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace PAX {
+    namespace {
+        /**
+         * The assigned indices in both directions.
+         * Indices are looked up by type such that a type gets the same index even if
+         * its static variable in TypeIndexRegistry::Of is duplicated (e.g., across shared libraries).
+         */
+        struct Registry {
+            std::mutex mutex;
+            std::unordered_map<TypeId, TypeIndex> indices;
+            std::vector<TypeId> types;
+            /// The indices of each kind of types (@ref TypeIndexRegistry::OfKind).
+            std::unordered_map<TypeId, std::unordered_map<TypeId, TypeIndex>> kinds;
+        };
+
+        Registry & GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+    }
+
+    TypeIndex TypeIndexRegistry::Register(const TypeId & type) {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        const auto inserted = registry.indices.emplace(type, TypeIndex(registry.types.size()));
+        if (inserted.second) {
+            registry.types.push_back(type);
+        }
+        return inserted.first->second;
+    }
+
+    TypeIndex TypeIndexRegistry::RegisterInKind(const TypeId & kind, const TypeId & type) {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::unordered_map<TypeId, TypeIndex> & indices = registry.kinds[kind];
+        return indices.emplace(type, TypeIndex(indices.size())).first->second;
+    }
+
+    TypeIndex TypeIndexRegistry::Find(const TypeId & type) {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        const auto it = registry.indices.find(type);
+        if (it != registry.indices.end()) {
+            return it->second;
+        }
+        return InvalidIndex;
+    }
+
+    TypeId TypeIndexRegistry::GetTypeId(TypeIndex index) {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (index >= registry.types.size()) {
+            PAX_THROW_RUNTIME_ERROR("There is no type with index " << index << "!");
+        }
+        return registry.types[index];
+    }
+
+    size_t TypeIndexRegistry::GetNumberOfTypes() {
+        Registry & registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        return registry.types.size();
+    }
+}
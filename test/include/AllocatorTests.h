@@ -5,10 +5,26 @@
 #ifndef POLYPROPYLENE_ALLOCATORTESTS_H
 #define POLYPROPYLENE_ALLOCATORTESTS_H
 
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
 #include "PaxTest.h"
 
+#include "Pizza.h"
 #include "toppings/TomatoSauce.h"
+#include "polypropylene/memory/PageMemory.h"
 #include "polypropylene/memory/PropertyPool.h"
+#include "polypropylene/memory/allocators/ArenaAllocator.h"
+#include "polypropylene/memory/allocators/ChainedAllocator.h"
+#include "polypropylene/memory/allocators/ConcurrentAllocator.h"
+#include "polypropylene/memory/allocators/MallocAllocator.h"
+#include "polypropylene/memory/allocators/SizeClassAllocator.h"
+#include "polypropylene/memory/allocators/SlabAllocator.h"
 
 namespace PAX {
     static void expect_equal(
@@ -50,6 +66,873 @@ namespace PAX {
             EXPECT_TRUE(false) << "The pool still contains instances of TomatoSauce although we deleted all of them!";
         }
     }
+
+    PAX_TEST(Allocator, PoolAllocatorGrowsByPagesAndShrinks)
+        PoolAllocator pool("IntPool", sizeof(int), 4);
+        std::vector<int*> ints;
+        for (int i = 0; i < 10; ++i) {
+            int * x = static_cast<int*>(pool.allocate());
+            *x = i;
+            ints.push_back(x);
+        }
+
+        EXPECT_EQ(pool.getNumberOfPages(), 3);
+        EXPECT_EQ(pool.getCapacity(), 12);
+
+        // Iteration has to cover all pages.
+        DefaultChunkValidator validator;
+        int expected = 0;
+        for (auto it = PropertyPoolIterator<int>::BeginOf(pool, validator); it != PropertyPoolIterator<int>::EndOf(pool, validator); ++it) {
+            EXPECT_EQ(**it, expected);
+            ++expected;
+        }
+        EXPECT_EQ(expected, 10);
+
+        // Free everything behind the first page.
+        while (ints.size() > 4) {
+            EXPECT_TRUE(pool.free(ints.back()));
+            ints.pop_back();
+        }
+        EXPECT_EQ(pool.shrink(), 2);
+        EXPECT_EQ(pool.getCapacity(), 4);
+
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_EQ(*ints.at(i), i) << "Shrinking moved or altered allocated elements!";
+            EXPECT_TRUE(pool.free(ints.at(i)));
+        }
+    }
+
+    PAX_TEST(Allocator, PoolAllocatorDecommitsFreeTailOnShrink)
+        constexpr PoolAllocator::Index PageCapacity = 8192;
+        PoolAllocator pool("MappedIntPool", sizeof(int), PageCapacity);
+        pool.setHugePages(true);
+        EXPECT_TRUE(pool.usesHugePages());
+
+        std::vector<int*> ints;
+        for (int i = 0; i < PageCapacity + 10; ++i) {
+            int * x = static_cast<int*>(pool.allocate());
+            *x = i + 1;
+            ints.push_back(x);
+        }
+
+        // Free the second page and the back of the first page.
+        constexpr size_t Kept = 1000;
+        while (ints.size() > Kept) {
+            EXPECT_TRUE(pool.free(ints.back()));
+            ints.pop_back();
+        }
+        EXPECT_EQ(pool.shrink(), 1);
+
+        for (size_t i = 0; i < Kept; ++i) {
+            EXPECT_EQ(*ints.at(i), int(i + 1)) << "Shrinking altered allocated elements!";
+        }
+
+        // Decommitted memory is still usable and reads as zero on Linux.
+        // Only whole system pages behind the kept chunks are decommitted.
+        const size_t systemPageSize = PageMemory::getSystemPageSize();
+        const char * decommitted = reinterpret_cast<const char*>(ints.front())
+                + (Kept * sizeof(int) + systemPageSize - 1) / systemPageSize * systemPageSize;
+        while (ints.size() < size_t(PageCapacity)) {
+            int * x = static_cast<int*>(pool.allocate());
+#ifdef PAX_OS_LINUX
+            if (reinterpret_cast<const char*>(x) >= decommitted) {
+                EXPECT_EQ(*x, 0);
+            }
+#else
+            PAX_UNREFERENCED_PARAMETER(decommitted)
+#endif
+            *x = 42;
+            ints.push_back(x);
+        }
+        EXPECT_EQ(pool.getNumberOfPages(), 1);
+
+        for (int * x : ints) {
+            EXPECT_TRUE(pool.free(x));
+        }
+    }
+
+    PAX_TEST(Allocator, PoolAllocatorRespectsMaxCapacity)
+        PoolAllocator pool("BoundedIntPool", sizeof(int), 2, 4);
+        std::vector<void*> ints;
+        for (int i = 0; i < 4; ++i) {
+            ints.push_back(pool.allocate());
+        }
+
+        PAX_LOG_DEBUG(Log::Level::Info, "The following error message is expected");
+        EXPECT_THROW(PAX_MAYBEUNUSED void * overflow = pool.allocate(), std::runtime_error);
+
+        for (void * i : ints) {
+            EXPECT_TRUE(pool.free(i));
+        }
+    }
+
+    PAX_TEST(Allocator, PoolAllocatorReusesLowestFreeChunkAndKeepsBounds)
+        PoolAllocator pool("CharPool", sizeof(char), 100);
+        std::set<PoolAllocator::Index> allocated;
+        std::vector<void*> data(5000, nullptr);
+        std::mt19937 random(42);
+
+        for (int step = 0; step < 5000; ++step) {
+            if (allocated.empty() || random() % 2 == 0) {
+                // The lowest free index has to be reused first.
+                PoolAllocator::Index expected = 0;
+                while (allocated.count(expected)) {
+                    ++expected;
+                }
+                void * mem = pool.allocate();
+                ASSERT_EQ(mem, pool.getData(expected));
+                allocated.insert(expected);
+                data.at(expected) = mem;
+            } else {
+                auto victim = allocated.begin();
+                std::advance(victim, random() % allocated.size());
+                ASSERT_TRUE(pool.free(data.at(*victim)));
+                allocated.erase(victim);
+            }
+
+            if (allocated.empty()) {
+                ASSERT_EQ(pool.begin(), pool.end());
+            } else {
+                ASSERT_EQ(pool.begin(), *allocated.begin());
+                ASSERT_EQ(pool.end(), *allocated.rbegin() + 1);
+            }
+        }
+
+        for (PoolAllocator::Index i : allocated) {
+            EXPECT_TRUE(pool.free(data.at(i)));
+        }
+    }
+
+    PAX_TEST(Allocator, PoolAllocatorAlignsPayloads)
+        PoolAllocator pool("AlignedPool", 24, 8, PoolAllocator::UnlimitedCapacity, 32);
+        EXPECT_EQ(pool.getAlignment(), 32);
+
+        std::vector<void*> chunks;
+        for (int i = 0; i < 20; ++i) {
+            chunks.push_back(pool.allocate());
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(chunks.back()) % 32, 0) << "Chunk " << i << " is misaligned!";
+        }
+
+        for (void * chunk : chunks) {
+            EXPECT_TRUE(pool.free(chunk));
+        }
+
+        // Without explicit alignment, the alignment is derived from the size.
+        EXPECT_EQ(PoolAllocator("DerivedAlignment", 12).getAlignment(), 4);
+        EXPECT_EQ(PoolAllocator("DerivedAlignment", 64).getAlignment(), alignof(std::max_align_t));
+    }
+
+    PAX_TEST(Allocator, IteratingSparsePoolSkipsFreeChunks)
+        PoolAllocator pool("SparsePool", sizeof(int), 256);
+        std::vector<int*> ints;
+        for (int i = 0; i < 1000; ++i) {
+            ints.push_back(static_cast<int*>(pool.allocate()));
+            *ints.back() = i;
+        }
+
+        for (int i = 0; i < 1000; ++i) {
+            if (i % 100 != 50) {
+                EXPECT_TRUE(pool.free(ints.at(i)));
+            }
+        }
+
+        DefaultChunkValidator validator;
+        std::vector<int> visited;
+        for (auto it = PropertyPoolIterator<int>::BeginOf(pool, validator); it != PropertyPoolIterator<int>::EndOf(pool, validator); ++it) {
+            visited.push_back(**it);
+        }
+
+        std::vector<int> expected;
+        for (int i = 50; i < 1000; i += 100) {
+            expected.push_back(i);
+            EXPECT_TRUE(pool.free(ints.at(i)));
+        }
+        EXPECT_EQ(visited, expected);
+    }
+
+    PAX_TEST(Allocator, HandlesNoticeDeletionAndReuseOfChunks)
+        using namespace PAX::Examples;
+
+        TomatoSauce * sauce = pax_new(TomatoSauce)(100);
+        Handle<TomatoSauce> handle = pax_handle(sauce);
+        EXPECT_TRUE(handle);
+        EXPECT_EQ(handle.get(), sauce);
+        EXPECT_EQ(handle->getScoville(), 100);
+        EXPECT_EQ(handle, pax_handle(sauce));
+
+        ASSERT_TRUE(pax_delete(sauce));
+        EXPECT_FALSE(handle);
+        EXPECT_EQ(handle.get(), nullptr);
+
+        // The pool reuses the chunk of the deleted sauce.
+        TomatoSauce * newSauce = pax_new(TomatoSauce)(200);
+        ASSERT_EQ(static_cast<void*>(newSauce), static_cast<void*>(sauce));
+        EXPECT_FALSE(handle) << "Handle to deleted property resolves to the property now living in the same chunk!";
+        EXPECT_NE(handle, pax_handle(newSauce));
+        EXPECT_TRUE(pax_handle(newSauce));
+
+        Pizza * pizza = pax_new(Pizza)();
+        Handle<Pizza> pizzaHandle = pax_handle(pizza);
+        EXPECT_EQ(pizzaHandle.get(), pizza);
+        ASSERT_TRUE(pax_delete(pizza));
+        EXPECT_FALSE(pizzaHandle);
+
+        ASSERT_TRUE(pax_delete(newSauce));
+        EXPECT_FALSE(Handle<TomatoSauce>());
+        EXPECT_FALSE(pax_handle<TomatoSauce>(nullptr));
+    }
+
+    struct RelocationListener {
+        std::vector<std::pair<Examples::TomatoSauce*, Examples::TomatoSauce*>> relocations;
+
+        void onRelocated(PropertyRelocatedEvent<Examples::Pizza, Examples::TomatoSauce> & e) {
+            relocations.emplace_back(e.oldLocation, e.property);
+        }
+    };
+
+    PAX_TEST(Allocator, CompactingPropertyPoolMovesPropertiesToFrontAndUpdatesEntities)
+        using namespace PAX::Examples;
+
+        PropertyPool<TomatoSauce> pool;
+        std::vector<Pizza*> pizzas;
+        for (int i = 0; i < 10; ++i) {
+            pizzas.push_back(pax_new(Pizza)());
+            ASSERT_TRUE(pizzas.back()->add(pax_new(TomatoSauce)(i)));
+        }
+
+        // Leave holes at the front of the pool.
+        for (int i = 0; i < 7; ++i) {
+            EXPECT_TRUE(pax_delete(pizzas.at(i)));
+        }
+        pizzas.erase(pizzas.begin(), pizzas.begin() + 7);
+        EXPECT_FALSE(pool.isCompact());
+
+        RelocationListener listener;
+        Pizza * lastPizza = pizzas.back();
+        lastPizza->getEventService().add<PropertyRelocatedEvent<Pizza, TomatoSauce>, RelocationListener, &RelocationListener::onRelocated>(&listener);
+        TomatoSauce * lastSauce = lastPizza->get<TomatoSauce>();
+
+        // Without any time budget, compaction proceeds by at least one property.
+        EXPECT_EQ(pool.compact(std::chrono::nanoseconds(0)), 1);
+        EXPECT_FALSE(pool.isCompact());
+        EXPECT_EQ(pool.compact(), 2);
+        EXPECT_TRUE(pool.isCompact());
+        EXPECT_EQ(pool.compact(), 0);
+
+        ASSERT_EQ(listener.relocations.size(), 1);
+        EXPECT_EQ(listener.relocations.front().first, lastSauce);
+        EXPECT_EQ(listener.relocations.front().second, lastPizza->get<TomatoSauce>());
+
+        // Entities have to reference the moved sauces, which have to be dense now.
+        std::set<TomatoSauce*> sauces;
+        for (int i = 0; i < 3; ++i) {
+            TomatoSauce * sauce = pizzas.at(i)->get<TomatoSauce>();
+            EXPECT_EQ(sauce->getScoville(), 7 + i);
+            EXPECT_EQ(sauce->getOwner(), pizzas.at(i));
+            EXPECT_EQ(pizzas.at(i)->getAllProperties().front(), sauce);
+            sauces.insert(sauce);
+        }
+
+        std::set<TomatoSauce*> pooled;
+        for (TomatoSauce * sauce : pool) {
+            pooled.insert(sauce);
+        }
+        EXPECT_EQ(sauces, pooled);
+
+        for (Pizza * pizza : pizzas) {
+            EXPECT_TRUE(pax_delete(pizza));
+        }
+    }
+
+    PAX_TEST(Allocator, SizeClassFactorySharesPoolsAcrossTypesOfSimilarSize)
+        struct Small { char data[12]; };
+        struct Medium { char data[24]; };
+        struct AlsoMedium { double data[4]; };
+
+        EXPECT_EQ(SizeClassAllocator::SizeClassOf(1), 16);
+        EXPECT_EQ(SizeClassAllocator::SizeClassOf(16), 16);
+        EXPECT_EQ(SizeClassAllocator::SizeClassOf(17), 32);
+        EXPECT_EQ(SizeClassAllocator::SizeClassOf(1000), 1024);
+
+        AllocationService service;
+        service.setDefaultAllocatorFactory(SizeClassAllocator::CreateFactory());
+
+        void * small = service.allocate(paxtypeof(Small));
+        void * medium = service.allocate(paxtypeof(Medium));
+        void * alsoMedium = service.allocate(paxtypeof(AlsoMedium));
+
+        PoolAllocator * mediumPool = service.getPoolAllocator(paxtypeid(Medium));
+        ASSERT_NE(mediumPool, nullptr);
+        EXPECT_EQ(mediumPool, service.getPoolAllocator(paxtypeid(AlsoMedium)));
+        EXPECT_NE(mediumPool, service.getPoolAllocator(paxtypeid(Small)));
+        EXPECT_EQ(mediumPool->getAllocationSize(), 32);
+        EXPECT_EQ(mediumPool->getNumberOfAllocations(), 2);
+        EXPECT_EQ(service.getAllocator(paxtypeid(Medium))->getAllocationSize(), sizeof(Medium));
+
+        EXPECT_TRUE(service.free(paxtypeid(Small), small));
+        EXPECT_TRUE(service.free(paxtypeid(Medium), medium));
+        EXPECT_TRUE(service.free(paxtypeid(AlsoMedium), alsoMedium));
+        EXPECT_EQ(mediumPool->getNumberOfAllocations(), 0);
+
+        // Thread-safe shared pools are not wrapped again by a thread-safe service.
+        AllocationService threadSafeService;
+        threadSafeService.setThreadSafe(true);
+        threadSafeService.setDefaultAllocatorFactory(SizeClassAllocator::CreateFactory(true));
+        void * threadSafeMedium = threadSafeService.allocate(paxtypeof(Medium));
+        EXPECT_TRUE(std::dynamic_pointer_cast<SizeClassAllocator>(threadSafeService.getAllocator(paxtypeid(Medium))));
+        EXPECT_TRUE(threadSafeService.free(paxtypeid(Medium), threadSafeMedium));
+
+        // Shared pools that are not thread-safe must not be used by a thread-safe service.
+        AllocationService mismatchedService;
+        mismatchedService.setThreadSafe(true);
+        mismatchedService.setDefaultAllocatorFactory(SizeClassAllocator::CreateFactory());
+        EXPECT_THROW(PAX_MAYBEUNUSED void * m = mismatchedService.allocate(paxtypeof(Medium)), std::runtime_error);
+    }
+
+    PAX_TEST(Allocator, HighWaterMarksPresizePoolsInLaterRuns)
+        struct Measured { int data[5]; };
+        const Path file = (std::filesystem::temp_directory_path() / "PolypropyleneTestHighWaterMarks.txt").string();
+        // More than fits into a single page.
+        const size_t peak = PoolAllocator::GetDefaultCapacity() + 1;
+
+        bool saved = false;
+        {
+            AllocationService firstRun;
+            std::vector<void*> memory;
+            for (size_t i = 0; i < peak; ++i) {
+                memory.push_back(firstRun.allocate(paxtypeof(Measured)));
+            }
+            for (void * m : memory) {
+                EXPECT_TRUE(firstRun.free(paxtypeid(Measured), m));
+            }
+            EXPECT_EQ(firstRun.getAllocator(paxtypeid(Measured))->getPeakNumberOfAllocations(), peak);
+            saved = firstRun.saveHighWaterMarks(file);
+        }
+
+        AllocationService secondRun;
+        const bool loaded = saved && secondRun.loadHighWaterMarks(file);
+        std::remove(file.c_str());
+        ASSERT_TRUE(saved);
+        ASSERT_TRUE(loaded);
+        EXPECT_EQ(secondRun.getCapacityHintFor(paxtypeof(Measured)), peak);
+        EXPECT_EQ(secondRun.getCapacityHintFor(paxtypeof(double)), 0);
+
+        // The pool keeps pages of default capacity but reserves enough of them right away.
+        void * m = secondRun.allocate(paxtypeof(Measured));
+        PoolAllocator * pool = secondRun.getPoolAllocator(paxtypeid(Measured));
+        ASSERT_NE(pool, nullptr);
+        EXPECT_GE(pool->getCapacity(), peak);
+        EXPECT_EQ(pool->getNumberOfPages(), 2);
+        EXPECT_TRUE(secondRun.free(paxtypeid(Measured), m));
+    }
+
+    PAX_TEST(Allocator, BulkAllocationFillsHolesFirstAndGrowsOnce)
+        PoolAllocator pool("BulkPool", sizeof(int), 64);
+        std::vector<void*> first(100);
+        pool.allocateN(first.size(), first.data());
+        EXPECT_EQ(pool.getNumberOfPages(), 2);
+
+        // Leave two holes.
+        EXPECT_TRUE(pool.free(first.at(3)));
+        EXPECT_TRUE(pool.free(first.at(70)));
+
+        std::vector<void*> second(200);
+        pool.allocateN(second.size(), second.data());
+        EXPECT_EQ(second.at(0), first.at(3));
+        EXPECT_EQ(second.at(1), first.at(70));
+        EXPECT_EQ(pool.getNumberOfAllocations(), 298);
+        EXPECT_EQ(pool.getNumberOfPages(), 5);
+        EXPECT_EQ(pool.begin(), 0);
+        EXPECT_EQ(pool.end(), 298);
+
+        std::set<void*> distinct(second.begin(), second.end());
+        distinct.insert(first.begin(), first.end());
+        EXPECT_EQ(distinct.size(), 298);
+
+        PoolAllocator bounded("BoundedPool", sizeof(int), 8, 16);
+        std::vector<void*> tooMany(17);
+        EXPECT_THROW(bounded.allocateN(tooMany.size(), tooMany.data()), std::runtime_error);
+        EXPECT_EQ(bounded.getNumberOfAllocations(), 0);
+
+        AllocationService service;
+        std::vector<void*> batch = service.allocateBatch(paxtypeof(float), 1000);
+        EXPECT_EQ(service.getPoolAllocator(paxtypeid(float))->getNumberOfAllocations(), 1000);
+        EXPECT_TRUE(service.freeBatch(paxtypeid(float), batch));
+        EXPECT_EQ(service.getPoolAllocator(paxtypeid(float))->getNumberOfAllocations(), 0);
+
+        EXPECT_EQ(pool.freeN(second.data(), second.size()), second.size());
+        first.erase(first.begin() + 70);
+        first.erase(first.begin() + 3);
+        EXPECT_EQ(pool.freeN(first.data(), first.size()), first.size());
+    }
+
+    PAX_TEST(Allocator, ArenaAllocatorBumpsAndDestroysOnReset)
+        struct HitMarker {
+            static int & Destructions() { static int destructions = 0; return destructions; }
+            int damage = 0;
+            explicit HitMarker(int damage) : damage(damage) {}
+            ~HitMarker() { ++Destructions(); }
+        };
+        struct QueryResult { double distance; };
+
+        auto arena = std::make_shared<Arena>(256);
+        AllocationService service;
+        service.registerAllocator(paxtypeid(HitMarker), ArenaAllocator::For<HitMarker>(arena));
+        service.registerAllocator(paxtypeid(QueryResult), ArenaAllocator::For<QueryResult>(arena));
+
+        for (int frame = 0; frame < 3; ++frame) {
+            HitMarker::Destructions() = 0;
+            std::vector<HitMarker*> markers;
+            for (int i = 0; i < 100; ++i) {
+                markers.push_back(new (service.allocate(paxtypeof(HitMarker))) HitMarker(i));
+                QueryResult * q = new (service.allocate(paxtypeof(QueryResult))) QueryResult{double(i)};
+                EXPECT_EQ(reinterpret_cast<std::uintptr_t>(q) % alignof(QueryResult), 0);
+            }
+            EXPECT_EQ(markers.at(99)->damage, 99);
+
+            // Deleted objects must not be destroyed again on reset.
+            EXPECT_TRUE(service.deleteAndFree(markers.at(42)));
+            EXPECT_EQ(HitMarker::Destructions(), 1);
+            EXPECT_FALSE(service.free(paxtypeid(HitMarker), markers.at(42)));
+            EXPECT_TRUE(service.deleteAndFree(markers.at(7)));
+            EXPECT_EQ(HitMarker::Destructions(), 2);
+
+            arena->reset();
+            EXPECT_EQ(HitMarker::Destructions(), 100);
+            EXPECT_EQ(arena->getBytesUsed(), 0);
+        }
+
+        // Blocks are reused after the first frame.
+        const size_t blocks = arena->getNumberOfBlocks();
+        for (int i = 0; i < 100; ++i) {
+            PAX_MAYBEUNUSED void * q = service.allocate(paxtypeof(QueryResult));
+        }
+        EXPECT_EQ(arena->getNumberOfBlocks(), blocks);
+        arena->reset();
+    }
+
+    PAX_TEST(Allocator, CachedAllocatorsFollowRegistrationsAndServices)
+        struct Cached { int data[3]; };
+        AllocationService service;
+        void * first = service.allocate<Cached>();
+        EXPECT_TRUE(service.hasAllocated(paxtypeid(Cached), first));
+        EXPECT_TRUE(service.free(paxtypeid(Cached), first));
+
+        // Registering another allocator has to invalidate the cached one.
+        auto replacement = std::make_shared<PoolAllocator>("Replacement", sizeof(Cached));
+        service.registerAllocator(paxtypeid(Cached), replacement);
+        auto * second = static_cast<Cached*>(service.allocate<Cached>());
+        EXPECT_TRUE(replacement->isMine(second));
+
+        // Other services must not use the allocator cached for this service.
+        AllocationService other;
+        auto * third = static_cast<Cached*>(other.allocate<Cached>());
+        EXPECT_FALSE(replacement->isMine(third));
+        EXPECT_FALSE(service.deleteAndFree(third, paxtypeid(Cached)));
+        EXPECT_TRUE(other.deleteAndFree(third, paxtypeid(Cached)));
+
+        EXPECT_TRUE(service.deleteAndFree(second, paxtypeid(Cached)));
+        EXPECT_EQ(replacement->getNumberOfAllocations(), 0);
+
+        // Cached allocators must not outlive their service.
+        std::weak_ptr<Allocator> pinned;
+        {
+            AllocationService shortLived;
+            void * data = shortLived.allocate<Cached>();
+            EXPECT_TRUE(shortLived.deleteAndFree(static_cast<Cached*>(data), paxtypeid(Cached)));
+            pinned = shortLived.getAllocator(paxtypeid(Cached));
+            EXPECT_FALSE(pinned.expired());
+        }
+        EXPECT_TRUE(pinned.expired());
+    }
+
+    PAX_TEST(Allocator, StatisticsReportChurnAndFragmentation)
+        struct Counted { double data[2]; };
+        AllocationService service;
+        std::vector<void*> memory;
+        for (int i = 0; i < 10; ++i) {
+            memory.push_back(service.allocate<Counted>());
+        }
+        // Free every second object to leave holes.
+        for (size_t i = 0; i < memory.size(); i += 2) {
+            EXPECT_TRUE(service.free(paxtypeid(Counted), memory[i]));
+        }
+
+        const AllocatorStatistics statistics = service.getStatistics().at(paxtypeid(Counted));
+        EXPECT_EQ(statistics.liveObjects, 5);
+        EXPECT_EQ(statistics.peakObjects, 10);
+        EXPECT_EQ(statistics.bytesUsed, 5 * sizeof(Counted));
+        EXPECT_GE(statistics.bytesReserved, 10 * sizeof(Counted));
+        // The live objects are at indices 1, 3, 5, 7, 9, so there are 4 holes in between.
+        EXPECT_DOUBLE_EQ(statistics.holeRatio, 4.0 / 9.0);
+#ifdef PAX_WITH_ALLOCATOR_STATISTICS
+        EXPECT_EQ(statistics.totalAllocations, 10);
+        EXPECT_EQ(statistics.totalFrees, 5);
+#endif
+
+        std::stringstream json;
+        service.writeStatistics(json);
+        EXPECT_NE(json.str().find("\"liveObjects\": 5"), std::string::npos) << json.str();
+
+        for (size_t i = 1; i < memory.size(); i += 2) {
+            EXPECT_TRUE(service.free(paxtypeid(Counted), memory[i]));
+        }
+    }
+
+    PAX_TEST(Allocator, ChainedAllocatorSpillsToSecondaryWhenPrimaryIsFull)
+        auto pool = std::make_shared<PoolAllocator>("BoundedPool", sizeof(int), 2, 4);
+        auto overflow = std::make_shared<MallocAllocator>("Overflow", sizeof(int));
+        ChainedAllocator chain(pool, overflow);
+
+        std::vector<void*> ints;
+        for (int i = 0; i < 6; ++i) {
+            ints.push_back(chain.allocate());
+        }
+        EXPECT_TRUE(pool->isFull());
+        EXPECT_EQ(chain.getNumberOfSpills(), 2);
+        EXPECT_TRUE(overflow->isMine(ints[4]));
+        EXPECT_TRUE(overflow->isMine(ints[5]));
+
+        // Freed chunks of the primary pool are reused before spilling again.
+        EXPECT_TRUE(chain.free(ints[0]));
+        EXPECT_TRUE(chain.free(ints[5]));
+        EXPECT_FALSE(overflow->isMine(ints[5]));
+        void * reused[2];
+        chain.allocateN(2, reused);
+        EXPECT_TRUE(pool->isMine(reused[0]));
+        EXPECT_TRUE(overflow->isMine(reused[1]));
+        EXPECT_EQ(chain.getNumberOfSpills(), 3);
+
+        const AllocatorStatistics statistics = chain.getStatistics();
+        EXPECT_EQ(statistics.liveObjects, 6);
+        EXPECT_EQ(statistics.spills, 3);
+
+        int notMine;
+        EXPECT_FALSE(chain.isMine(&notMine));
+        EXPECT_FALSE(chain.free(&notMine));
+
+        EXPECT_EQ(chain.freeN(ints.data() + 1, 4), 4);
+        EXPECT_EQ(chain.freeN(reused, 2), 2);
+        EXPECT_EQ(pool->getNumberOfAllocations(), 0);
+
+        // Services with a chaining factory do not throw when a pool is full.
+        AllocationService service;
+        service.setDefaultAllocatorFactory(ChainedAllocator::CreateFactory(2));
+        std::vector<void*> doubles = service.allocateBatch(paxtypeof(double), 3);
+        doubles.push_back(service.allocate(paxtypeof(double)));
+        ASSERT_NE(service.getPoolAllocator(paxtypeid(double)), nullptr);
+        EXPECT_EQ(service.getPoolAllocator(paxtypeid(double))->getNumberOfAllocations(), 2);
+        EXPECT_EQ(service.getStatistics().at(paxtypeid(double)).spills, 2);
+        EXPECT_TRUE(service.freeBatch(paxtypeid(double), doubles));
+    }
+
+    PAX_TEST(Allocator, PropertyPoolsRefuseAllocatorsTheyCannotIterate)
+        using namespace Examples;
+        AllocationService service;
+        service.setDefaultAllocatorFactory(ChainedAllocator::CreateFactory(4));
+        AllocationServiceScope<Pizza> scope(service);
+
+        TomatoSauce * sauce = pax_new(TomatoSauce)(1);
+        EXPECT_THROW(PropertyPool<TomatoSauce>{service}, std::runtime_error);
+        // The chained allocator is kept, so the sauce can still be deleted.
+        EXPECT_TRUE(std::dynamic_pointer_cast<ChainedAllocator>(service.getAllocator(paxtypeid(TomatoSauce))));
+        EXPECT_TRUE(pax_delete(sauce));
+
+        service.registerAllocator(paxtypeid(TomatoSauce), std::make_shared<MallocAllocator>("Sauces", sizeof(TomatoSauce)));
+        EXPECT_THROW(PropertyPool<TomatoSauce>{service}, std::runtime_error);
+    }
+
+    PAX_TEST(Allocator, SlabAllocatorGrowsWithoutLimitAndReusesFreedChunks)
+        struct Particle { float position[3]; };
+        SlabAllocator slabs("Particles", sizeof(Particle));
+        std::vector<Particle*> particles;
+        for (int i = 0; i < 10000; ++i) {
+            auto * p = static_cast<Particle*>(slabs.allocate());
+            p->position[0] = float(i);
+            particles.push_back(p);
+        }
+        EXPECT_GT(slabs.getNumberOfSlabs(), 1);
+        EXPECT_EQ(std::set<Particle*>(particles.begin(), particles.end()).size(), particles.size());
+        for (int i = 0; i < 10000; ++i) {
+            EXPECT_TRUE(slabs.isMine(particles[size_t(i)]));
+            EXPECT_EQ(particles[size_t(i)]->position[0], float(i));
+        }
+
+        int notMine;
+        EXPECT_FALSE(slabs.isMine(&notMine));
+        EXPECT_FALSE(slabs.free(&notMine));
+        EXPECT_FALSE(slabs.free(reinterpret_cast<char*>(particles[0]) + 1)) << "Freed a pointer into the middle of a chunk.";
+
+        // The most recently freed chunk is reused first.
+        Particle * freed = particles.back();
+        EXPECT_TRUE(slabs.free(freed));
+        particles.pop_back();
+        const size_t numberOfSlabs = slabs.getNumberOfSlabs();
+        EXPECT_EQ(slabs.allocate(), freed);
+        particles.push_back(freed);
+        EXPECT_EQ(slabs.getNumberOfSlabs(), numberOfSlabs);
+
+        EXPECT_EQ(slabs.getStatistics().liveObjects, particles.size());
+        for (Particle * p : particles) {
+            EXPECT_TRUE(slabs.free(p));
+        }
+        EXPECT_EQ(slabs.getStatistics().liveObjects, 0);
+    }
+
+    PAX_TEST(Allocator, DestroyAllRunsRegisteredDestructorsAndFreesPoolsAtOnce)
+        static int destroyed = 0;
+        struct Tracked {
+            int value = 0;
+            ~Tracked() { ++destroyed; }
+        };
+        struct Plain { int value; };
+
+        AllocationService service;
+        std::vector<Tracked*> tracked;
+        for (int i = 0; i < 100; ++i) {
+            tracked.push_back(new (service.allocate<Tracked>()) Tracked());
+            PAX_MAYBEUNUSED void * plain = service.allocate<Plain>();
+        }
+        EXPECT_TRUE(service.deleteAndFree(tracked[50]));
+        EXPECT_EQ(destroyed, 1);
+        Handle<Tracked> handle = service.getHandle(tracked[0]);
+
+        EXPECT_TRUE(service.destroyAll());
+        EXPECT_EQ(destroyed, 100) << "Expected each remaining object to be destroyed exactly once.";
+        EXPECT_FALSE(handle);
+        EXPECT_EQ(service.getPoolAllocator(paxtypeid(Tracked))->getNumberOfAllocations(), 0);
+        EXPECT_EQ(service.getPoolAllocator(paxtypeid(Plain))->getNumberOfAllocations(), 0);
+        EXPECT_FALSE(service.isDestroyingAll());
+    }
+
+    PAX_TEST(Allocator, DestroyAllReportsObjectsWithUnknownDestructor)
+        struct Known { std::string name; };
+        struct Unknown { std::string name; };
+
+        AllocationService service;
+        PAX_MAYBEUNUSED Known * known = new (service.allocate<Known>()) Known { "known" };
+        PAX_MAYBEUNUSED void * unknown = service.allocate(paxtypeof(Unknown));
+        EXPECT_FALSE(service.destroyAll()) << "Freed objects without knowing how to destroy them.";
+        EXPECT_EQ(service.getPoolAllocator(paxtypeid(Unknown))->getNumberOfAllocations(), 0);
+
+        // Types are known, no matter whether they are trivially destructible.
+        known = new (service.allocate<Known>()) Known { "known" };
+        PAX_MAYBEUNUSED void * plain = service.allocate<int>();
+        service.registerDestructor<Unknown>();
+        unknown = new (service.allocate(paxtypeof(Unknown))) Unknown { "unknown" };
+        EXPECT_TRUE(service.destroyAll());
+    }
+
+    PAX_TEST(Allocator, FreeAllInvalidatesHandlesWithoutTouchingChunks)
+        PoolAllocator pool("FreeAll", sizeof(int), 100);
+        std::vector<int*> chunks;
+        for (int i = 0; i < 250; ++i) {
+            chunks.push_back(static_cast<int*>(pool.allocate()));
+        }
+        EXPECT_TRUE(pool.free(chunks[10]));
+        Handle<int> first(pool, chunks[0]);
+        Handle<int> last(pool, chunks.back());
+
+        pool.freeAll();
+        EXPECT_FALSE(first);
+        EXPECT_FALSE(last);
+        EXPECT_EQ(pool.getNumberOfAllocations(), 0);
+        EXPECT_EQ(pool.begin(), pool.end());
+        EXPECT_EQ(pool.getNumberOfPages(), 3);
+        for (PoolAllocator::Index i = 0; i < pool.getCapacity(); ++i) {
+            EXPECT_FALSE(pool.isAllocated(i));
+        }
+
+        // The pool is reused from the front and chunks can be freed individually again.
+        for (int i = 0; i < 150; ++i) {
+            EXPECT_EQ(pool.allocate(), chunks[size_t(i)]);
+        }
+        EXPECT_FALSE(first) << "Reallocating a chunk revived a handle from before freeAll.";
+        EXPECT_TRUE(Handle<int>(pool, chunks[0]));
+        EXPECT_TRUE(pool.free(chunks[0]));
+        EXPECT_FALSE(pool.free(chunks[200])) << "Freed a chunk that was freed by freeAll already.";
+        EXPECT_EQ(pool.nextAllocated(0), 1);
+        EXPECT_EQ(pool.end(), 150);
+        EXPECT_EQ(pool.shrink(), 1);
+        pool.freeAll();
+        EXPECT_TRUE(pool.clear());
+    }
+
+    PAX_TEST(Allocator, ConcurrentAllocatorHandsBackAllChunksOnFlush)
+        auto pool = std::make_shared<PoolAllocator>("ConcurrentPool", sizeof(size_t), 64);
+        ConcurrentAllocator concurrent(pool, 8);
+
+        constexpr size_t NumThreads = 4;
+        constexpr size_t NumChunks = 1000;
+        std::vector<std::vector<size_t*>> chunksPerThread(NumThreads);
+
+        // Each thread allocates chunks ...
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < NumThreads; ++t) {
+            threads.emplace_back([&concurrent, &chunksPerThread, t]() {
+                for (size_t i = 0; i < NumChunks; ++i) {
+                    size_t * chunk = static_cast<size_t*>(concurrent.allocate());
+                    *chunk = t;
+                    chunksPerThread[t].push_back(chunk);
+                }
+            });
+        }
+        for (std::thread & thread : threads) {
+            thread.join();
+        }
+        threads.clear();
+
+        std::set<size_t*> distinct;
+        for (size_t t = 0; t < NumThreads; ++t) {
+            for (size_t * chunk : chunksPerThread[t]) {
+                EXPECT_EQ(*chunk, t) << "Chunk was handed out to multiple threads!";
+                EXPECT_TRUE(concurrent.isMine(chunk));
+                distinct.insert(chunk);
+            }
+        }
+        EXPECT_EQ(distinct.size(), NumThreads * NumChunks);
+        Handle<size_t> handle(*pool, chunksPerThread[0][0]);
+        EXPECT_TRUE(handle);
+
+        // ... and the chunks are freed by another thread.
+        for (size_t t = 0; t < NumThreads; ++t) {
+            threads.emplace_back([&concurrent, &chunksPerThread, t]() {
+                for (size_t * chunk : chunksPerThread[(t + 1) % NumThreads]) {
+                    EXPECT_TRUE(concurrent.free(chunk));
+                }
+            });
+        }
+        for (std::thread & thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_GT(pool->getNumberOfAllocations(), 0) << "Expected threads to cache some chunks.";
+        concurrent.flush();
+        EXPECT_EQ(pool->getNumberOfAllocations(), 0);
+        // Handles are invalidated once the chunks are given back to the pool.
+        EXPECT_FALSE(handle) << "Giving a chunk back to the pool did not invalidate handles to it.";
+    }
+
+    PAX_TEST(Allocator, ConcurrentAllocatorsCanBeCreatedAndDestroyedRepeatedly)
+        // Each allocator creates a magazine for this thread that has to be dropped once the allocator is gone.
+        for (int i = 0; i < 100; ++i) {
+            ConcurrentAllocator concurrent(std::make_shared<PoolAllocator>("Short-lived", sizeof(size_t), 64), 4);
+            void * chunk = concurrent.allocate();
+            EXPECT_TRUE(concurrent.free(chunk));
+#ifdef PAX_BUILD_TYPE_DEBUG
+            EXPECT_FALSE(concurrent.free(chunk)) << "Freed a chunk twice.";
+            size_t notMine;
+            EXPECT_FALSE(concurrent.free(&notMine));
+#endif
+            concurrent.flush();
+            EXPECT_EQ(concurrent.getBackend()->getStatistics().liveObjects, 0);
+        }
+    }
+
+    PAX_TEST(Allocator, PropertyPoolsRefuseSharedSizeClassPools)
+        using namespace Examples;
+        AllocationService service;
+        service.setDefaultAllocatorFactory(SizeClassAllocator::CreateFactory());
+        AllocationServiceScope<Pizza> scope(service);
+
+        TomatoSauce * sauce = pax_new(TomatoSauce)(1);
+        EXPECT_THROW(PropertyPool<TomatoSauce>{service}, std::runtime_error);
+        EXPECT_TRUE(std::dynamic_pointer_cast<SizeClassAllocator>(service.getAllocator(paxtypeid(TomatoSauce))));
+        EXPECT_TRUE(pax_delete(sauce));
+
+        // Pools created before the first allocation get a dedicated PoolAllocator.
+        AllocationService otherService;
+        otherService.setDefaultAllocatorFactory(SizeClassAllocator::CreateFactory());
+        PropertyPool<TomatoSauce> pool(otherService);
+        AllocationServiceScope<Pizza> otherScope(otherService);
+        sauce = pax_new(TomatoSauce)(2);
+        EXPECT_TRUE(std::dynamic_pointer_cast<PoolAllocator>(otherService.getAllocator(paxtypeid(TomatoSauce))));
+        size_t pooled = 0;
+        for (PAX_MAYBEUNUSED TomatoSauce * pooledSauce : pool) {
+            ++pooled;
+        }
+        EXPECT_EQ(pooled, 1);
+        EXPECT_TRUE(pax_delete(sauce));
+    }
+
+    PAX_TEST(Allocator, ThreadSafeAllocationServiceWrapsDefaultAllocators)
+        AllocationService service;
+        service.setThreadSafe(true);
+        EXPECT_TRUE(service.isThreadSafe());
+
+        constexpr size_t NumThreads = 4;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < NumThreads; ++t) {
+            threads.emplace_back([&service]() {
+                std::vector<void*> memory;
+                for (int i = 0; i < 500; ++i) {
+                    memory.push_back(service.allocate(paxtypeof(double)));
+                }
+                for (void * m : memory) {
+                    EXPECT_TRUE(service.hasAllocated(paxtypeid(double), m));
+                    EXPECT_TRUE(service.free(paxtypeid(double), m));
+                }
+            });
+        }
+        for (std::thread & thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_TRUE(std::dynamic_pointer_cast<ConcurrentAllocator>(service.getAllocator(paxtypeid(double))));
+#ifdef PAX_WITH_ALLOCATOR_STATISTICS
+        const AllocatorStatistics statistics = service.getStatistics().at(paxtypeid(double));
+        EXPECT_EQ(statistics.totalAllocations, NumThreads * 500);
+        EXPECT_EQ(statistics.liveObjects, 0);
+#endif
+    }
+
+    /// Stands in for a vector type whose SIMD loads require 64 byte alignment.
+    struct alignas(64) AlignedVector {
+        float values[8];
+    };
+
+    static bool is_aligned(const void * data, size_t alignment) {
+        return reinterpret_cast<std::uintptr_t>(data) % alignment == 0;
+    }
+
+    PAX_TEST(Allocator, OverAlignedTypesAreAllocatedAligned)
+        const Type type = paxtypeof(AlignedVector);
+        EXPECT_EQ(type.alignment, 64);
+        EXPECT_EQ(paxtypeof(char[3]).alignment, 1);
+        EXPECT_EQ(Type(paxtypeid(AlignedVector), 64).alignment, alignof(std::max_align_t));
+
+        // The empty factory stands for the default one of AllocationService.
+        const std::vector<AllocationService::AllocatorFactory> factories = {
+                nullptr,
+                SizeClassAllocator::CreateFactory(),
+                ChainedAllocator::CreateFactory(4)
+        };
+        for (const AllocationService::AllocatorFactory & factory : factories) {
+            AllocationService service;
+            if (factory) {
+                service.setDefaultAllocatorFactory(factory);
+            }
+            std::vector<AlignedVector*> vectors;
+            for (int i = 0; i < 10; ++i) {
+                vectors.push_back(new (service.allocate<AlignedVector>()) AlignedVector());
+                EXPECT_TRUE(is_aligned(vectors.back(), 64)) << vectors.back() << " is misaligned!";
+            }
+            EXPECT_EQ(service.getAllocator(paxtypeid(AlignedVector))->getAlignment() % 64, 0);
+            for (AlignedVector * v : vectors) {
+                EXPECT_TRUE(service.free(paxtypeid(AlignedVector), v));
+            }
+        }
+
+        MallocAllocator mallocAllocator("AlignedVector", sizeof(AlignedVector), alignof(AlignedVector));
+        void * data = mallocAllocator.allocate();
+        EXPECT_TRUE(is_aligned(data, 64));
+        EXPECT_TRUE(mallocAllocator.free(data));
+
+        // Allocators that cannot guarantee the alignment of a type are rejected.
+        AllocationService service;
+        service.registerAllocator(paxtypeid(AlignedVector), std::make_shared<PoolAllocator>("Underaligned", sizeof(AlignedVector), 4, 4, 16));
+        EXPECT_THROW(PAX_MAYBEUNUSED void * memory = service.allocate(type), std::runtime_error);
+    }
 }
 
 #endif //POLYPROPYLENE_ALLOCATORTESTS_H
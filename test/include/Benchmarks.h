@@ -0,0 +1,639 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#ifndef POLYPROPYLENE_BENCHMARKS_H
+#define POLYPROPYLENE_BENCHMARKS_H
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#include "PaxTest.h"
+
+#include "Pizza.h"
+#include "toppings/TomatoSauce.h"
+#include "BakedEvent.h"
+#include "polypropylene/property/EntityManagerView.h"
+#include "polypropylene/reflection/TypeIndex.h"
+
+#include "polypropylene/memory/allocators/ConcurrentAllocator.h"
+#include "polypropylene/memory/allocators/MallocAllocator.h"
+#include "polypropylene/memory/allocators/PoolAllocator.h"
+#include "polypropylene/memory/allocators/SlabAllocator.h"
+
+/**
+ * Benchmarks are built into their own executable polypropylenebenchmarks (cmake option POLYPROPYLENE_WITH_BENCHMARKS)
+ * and are not part of the tests, as wall-clock measurements are unreliable in debug or sanitizer builds
+ * and on busy machines.
+ * They print their measurements and fail if the expected speedups or complexities are not met.
+ * Run them on an otherwise idle machine with a release build.
+ */
+namespace PAX {
+    namespace Benchmark {
+        using Clock = std::chrono::steady_clock;
+
+        template<typename Function>
+        double nanosecondsPer(size_t repetitions, Function && f) {
+            const Clock::time_point start = Clock::now();
+            f();
+            const Clock::time_point stop = Clock::now();
+            return double(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()) / double(repetitions);
+        }
+
+        inline void report(const std::string & what, double value, const std::string & unit) {
+            std::cout << "\n    " << std::left << std::setw(56) << what << std::right << std::setw(12) << std::fixed << std::setprecision(2) << value << " " << unit;
+        }
+
+        /**
+         * @return The number of bytes that are currently allocated with the global operator new.
+         *         Over-aligned allocations are not counted.
+         *         The counting operator new is defined in polypropyleneBenchmarks.cpp.
+         */
+        size_t heapBytes();
+
+        /**
+         * Counts the bytes that are currently allocated through it in CountingAllocator<T>::bytes.
+         */
+        template<typename T>
+        struct CountingAllocator {
+            using value_type = T;
+
+            static size_t & bytes() {
+                static size_t bytes = 0;
+                return bytes;
+            }
+
+            CountingAllocator() = default;
+            template<typename U>
+            CountingAllocator(const CountingAllocator<U> &) {} // NOLINT(google-explicit-constructor)
+
+            T * allocate(size_t n) {
+                CountingAllocator<char>::bytes() += n * sizeof(T);
+                return std::allocator<T>().allocate(n);
+            }
+
+            void deallocate(T * p, size_t n) {
+                CountingAllocator<char>::bytes() -= n * sizeof(T);
+                std::allocator<T>().deallocate(p, n);
+            }
+
+            template<typename U>
+            bool operator==(const CountingAllocator<U> &) const { return true; }
+            template<typename U>
+            bool operator!=(const CountingAllocator<U> &) const { return false; }
+        };
+    }
+
+    PAX_TEST(Benchmark, PoolAllocatorFreeCostIsIndependentOfPoolSize)
+        // Freeing in ascending order of addresses was the worst case for the former sorted free stack.
+        std::vector<double> nsPerFree;
+        for (PoolAllocator::Index size : {1 << 12, 1 << 15, 1 << 18}) {
+            PoolAllocator pool("BenchmarkPool", 16);
+            std::vector<void*> chunks(size);
+            for (void *& chunk : chunks) {
+                chunk = pool.allocate();
+            }
+
+            nsPerFree.push_back(Benchmark::nanosecondsPer(chunks.size(), [&pool, &chunks]() {
+                for (void * chunk : chunks) {
+                    PAX_MAYBEUNUSED bool freed = pool.free(chunk);
+                }
+            }));
+            Benchmark::report("PoolAllocator::free with " + std::to_string(size) + " chunks", nsPerFree.back(), "ns/free");
+        }
+        std::cout << std::endl;
+
+        EXPECT_LT(nsPerFree.back(), 10 * nsPerFree.front()) << "Freeing does not scale independently of the pool size.";
+    }
+
+    PAX_TEST(Benchmark, ConcurrentAllocatorScalesWithThreads)
+        constexpr size_t Rounds = 20000;
+        // Small enough to stay in the magazine of each thread (which holds up to 2 * DefaultBatchSize chunks)
+        // such that we measure the thread-local fast path and not the backend.
+        constexpr size_t ChunksPerRound = ConcurrentAllocator::DefaultBatchSize;
+        const size_t cores = std::thread::hardware_concurrency();
+        if (cores < 2) {
+            std::cout << std::endl;
+            GTEST_SKIP() << "Scaling cannot be observed on a single core.";
+        }
+
+        // Each thread repeatedly allocates a batch of chunks and frees it again.
+        // Total work grows with the number of threads, so perfect scaling keeps the time per operation constant per core.
+        std::vector<double> millionOpsPerSecond;
+        std::vector<size_t> threadCounts;
+        for (size_t numThreads = 1; numThreads <= cores; numThreads *= 2) {
+            auto pool = std::make_shared<PoolAllocator>("BenchmarkPool", 16);
+            ConcurrentAllocator concurrent(pool);
+
+            const size_t operations = 2 * numThreads * Rounds * ChunksPerRound;
+            const double nsPerOperation = Benchmark::nanosecondsPer(operations, [&concurrent, numThreads]() {
+                std::vector<std::thread> threads;
+                for (size_t t = 0; t < numThreads; ++t) {
+                    threads.emplace_back([&concurrent]() {
+                        std::vector<void*> chunks(ChunksPerRound);
+                        for (size_t round = 0; round < Rounds; ++round) {
+                            for (void *& chunk : chunks) {
+                                chunk = concurrent.allocate();
+                            }
+                            for (void * chunk : chunks) {
+                                PAX_MAYBEUNUSED bool freed = concurrent.free(chunk);
+                            }
+                        }
+                    });
+                }
+                for (std::thread & thread : threads) {
+                    thread.join();
+                }
+            });
+
+            millionOpsPerSecond.push_back(1000.0 / nsPerOperation);
+            threadCounts.push_back(numThreads);
+            Benchmark::report("ConcurrentAllocator with " + std::to_string(numThreads) + " threads", millionOpsPerSecond.back(), "M ops/s");
+        }
+        std::cout << std::endl;
+
+        // Threads share nothing on the fast path, so throughput has to grow with the number of threads.
+        const double speedup = millionOpsPerSecond.back() / millionOpsPerSecond.front();
+        EXPECT_GT(speedup, 0.6 * double(threadCounts.back()))
+            << "ConcurrentAllocator with " << threadCounts.back() << " threads is only " << speedup << " times faster than with one thread.";
+    }
+
+    PAX_TEST(Benchmark, BatchAllocationIsFasterThanSingleAllocations)
+        struct Spawned { double data[4]; };
+        constexpr size_t Count = 10000;
+
+        AllocationService single;
+        std::vector<void*> singles(Count);
+        const double nsPerSingle = Benchmark::nanosecondsPer(Count, [&single, &singles]() {
+            for (void *& memory : singles) {
+                memory = single.allocate(paxtypeof(Spawned));
+            }
+        });
+
+        AllocationService batched;
+        std::vector<void*> batch;
+        const double nsPerBatched = Benchmark::nanosecondsPer(Count, [&batched, &batch]() {
+            batch = batched.allocateBatch(paxtypeof(Spawned), Count);
+        });
+
+        Benchmark::report("AllocationService::allocate of " + std::to_string(Count) + " objects", nsPerSingle, "ns/object");
+        Benchmark::report("AllocationService::allocateBatch of " + std::to_string(Count) + " objects", nsPerBatched, "ns/object");
+        std::cout << std::endl;
+
+        EXPECT_TRUE(single.freeBatch(paxtypeid(Spawned), singles));
+        EXPECT_TRUE(batched.freeBatch(paxtypeid(Spawned), batch));
+        EXPECT_LT(nsPerBatched, 2 * nsPerSingle) << "Batch allocation is slower than allocating objects one by one.";
+    }
+
+    PAX_TEST(Benchmark, CachedAllocatorSlotIsFasterThanTypeLookup)
+        struct Looked { double data[4]; };
+        constexpr size_t Count = 100000;
+        AllocationService service;
+        std::vector<void*> memory(Count);
+
+        const double nsPerLookup = Benchmark::nanosecondsPer(Count, [&service, &memory]() {
+            for (void *& m : memory) {
+                m = service.allocate(paxtypeof(Looked));
+            }
+        });
+        EXPECT_TRUE(service.freeBatch(paxtypeid(Looked), memory));
+
+        const double nsPerCached = Benchmark::nanosecondsPer(Count, [&service, &memory]() {
+            for (void *& m : memory) {
+                m = service.allocate<Looked>();
+            }
+        });
+        EXPECT_TRUE(service.freeBatch(paxtypeid(Looked), memory));
+
+        Benchmark::report("AllocationService::allocate(Type)", nsPerLookup, "ns/object");
+        Benchmark::report("AllocationService::allocate<T>()", nsPerCached, "ns/object");
+        std::cout << std::endl;
+
+        EXPECT_LT(nsPerCached, 2 * nsPerLookup) << "Cached allocator slots are slower than looking up the allocator.";
+    }
+
+    PAX_TEST(Benchmark, SlabAllocatorIsFasterThanMallocAllocator)
+        struct Dynamic { double data[3]; };
+        constexpr size_t Count = 100000;
+        std::vector<void*> memory(Count);
+
+        const auto allocateAndFree = [&memory](Allocator & allocator) {
+            return Benchmark::nanosecondsPer(Count, [&allocator, &memory]() {
+                for (void *& m : memory) {
+                    m = allocator.allocate();
+                }
+                for (void * m : memory) {
+                    PAX_MAYBEUNUSED bool freed = allocator.free(m);
+                }
+            });
+        };
+
+        MallocAllocator mallocAllocator("Malloc", sizeof(Dynamic));
+        SlabAllocator slabAllocator("Slab", sizeof(Dynamic));
+        const double nsPerMalloc = allocateAndFree(mallocAllocator);
+        const double nsPerSlab = allocateAndFree(slabAllocator);
+
+        Benchmark::report("MallocAllocator allocate + free", nsPerMalloc, "ns/object");
+        Benchmark::report("SlabAllocator allocate + free", nsPerSlab, "ns/object");
+        std::cout << std::endl;
+
+        EXPECT_LT(nsPerSlab, nsPerMalloc) << "SlabAllocator is slower than MallocAllocator.";
+    }
+
+    PAX_TEST(Benchmark, DestroyingWorldIsFasterThanClearing)
+        using namespace Examples;
+        constexpr size_t NumberOfPizzas = 20000;
+        const auto populate = [](EntityManager<Pizza> & world) {
+            AllocationServiceScope<Pizza> scope(world.getAllocationService());
+            for (size_t i = 0; i < NumberOfPizzas; ++i) {
+                Pizza * pizza = pax_new(Pizza)();
+                PAX_MAYBEUNUSED bool added = pizza->add(pax_new(TomatoSauce)(int(i)));
+                world.add(pizza);
+            }
+        };
+
+        EventService events;
+        AllocationService clearedService;
+        EntityManager<Pizza> cleared(events, clearedService);
+        populate(cleared);
+        const double nsPerClearedPizza = Benchmark::nanosecondsPer(NumberOfPizzas, [&cleared]() {
+            cleared.clear();
+        });
+
+        AllocationService destroyedService;
+        EntityManager<Pizza> destroyed(events, destroyedService);
+        populate(destroyed);
+        const double nsPerDestroyedPizza = Benchmark::nanosecondsPer(NumberOfPizzas, [&destroyed]() {
+            PAX_MAYBEUNUSED bool destroyedAll = destroyed.destroyWorld();
+        });
+
+        Benchmark::report("EntityManager::clear", nsPerClearedPizza, "ns/entity");
+        Benchmark::report("EntityManager::destroyWorld", nsPerDestroyedPizza, "ns/entity");
+        std::cout << std::endl;
+
+        EXPECT_LT(nsPerDestroyedPizza, nsPerClearedPizza) << "Destroying a world is slower than clearing it.";
+    }
+
+    PAX_TEST(Benchmark, ViewUpdateCostIsIndependentOfViewSize)
+        using namespace Examples;
+        // Detaching and attaching again in ascending order of addresses was the worst case for the former sorted vector.
+        std::vector<double> nsPerUpdate;
+        for (size_t numberOfPizzas : {1000, 64000}) {
+            EventService events;
+            AllocationService service;
+            AllocationServiceScope<Pizza> scope(service);
+            EntityManager<Pizza> world(events, service);
+            EntityManagerView<Pizza, Champignon> view(world);
+
+            std::vector<std::pair<Pizza*, Champignon*>> pizzas;
+            for (size_t i = 0; i < numberOfPizzas; ++i) {
+                Pizza * pizza = pax_new(Pizza)();
+                Champignon * champignon = pax_new(Champignon)();
+                PAX_MAYBEUNUSED bool added = pizza->add(champignon);
+                world.add(pizza);
+                pizzas.emplace_back(pizza, champignon);
+            }
+            std::sort(pizzas.begin(), pizzas.end());
+
+            nsPerUpdate.push_back(Benchmark::nanosecondsPer(2 * numberOfPizzas, [&pizzas]() {
+                for (const auto & pizza : pizzas) {
+                    PAX_MAYBEUNUSED bool removed = pizza.first->remove(pizza.second);
+                }
+                for (const auto & pizza : pizzas) {
+                    PAX_MAYBEUNUSED bool added = pizza.first->add(pizza.second);
+                }
+            }));
+            Benchmark::report("EntityManagerView update with " + std::to_string(numberOfPizzas) + " entities", nsPerUpdate.back(), "ns/update");
+
+            EXPECT_EQ(view.size(), numberOfPizzas);
+            PAX_MAYBEUNUSED bool destroyed = world.destroyWorld();
+        }
+        std::cout << std::endl;
+
+        EXPECT_LT(nsPerUpdate.back(), 10 * nsPerUpdate.front()) << "Updating views does not scale independently of their size.";
+    }
+
+    PAX_TEST(Benchmark, IteratingCachedViewPropertiesIsFasterThanGettingThem)
+        using namespace Examples;
+        constexpr size_t NumberOfPizzas = 20000;
+        constexpr size_t Rounds = 10;
+        EventService events;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        EntityManager<Pizza> world(events, service);
+        EntityManagerView<Pizza, Champignon, TomatoSauce> view(world);
+        for (size_t i = 0; i < NumberOfPizzas; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            PAX_MAYBEUNUSED bool added = pizza->add(pax_new(Champignon)()) && pizza->add(pax_new(TomatoSauce)(int(i)));
+            world.add(pizza);
+        }
+
+        int scovilleByGet = 0;
+        const double nsPerGet = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&view, &scovilleByGet]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                for (Pizza * pizza : view) {
+                    scovilleByGet += pizza->get<TomatoSauce>()->getScoville() + int(pizza->get<Champignon>() == nullptr);
+                }
+            }
+        });
+
+        int scovilleByEach = 0;
+        const double nsPerEach = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&view, &scovilleByEach]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                view.each([&scovilleByEach](Pizza &, Champignon &, TomatoSauce & sauce) {
+                    scovilleByEach += sauce.getScoville();
+                });
+            }
+        });
+
+        Benchmark::report("EntityManagerView iteration with Entity::get", nsPerGet, "ns/entity");
+        Benchmark::report("EntityManagerView::each", nsPerEach, "ns/entity");
+        std::cout << std::endl;
+
+        EXPECT_EQ(scovilleByGet, scovilleByEach);
+        EXPECT_LT(nsPerEach, nsPerGet) << "Iterating cached properties is slower than getting them from the entities.";
+        PAX_MAYBEUNUSED bool destroyed = world.destroyWorld();
+    }
+
+    PAX_TEST(Benchmark, ExcludingViewIsFasterThanFilteringByHand)
+        using namespace Examples;
+        constexpr size_t NumberOfPizzas = 20000;
+        constexpr size_t Rounds = 10;
+        EventService events;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        EntityManager<Pizza> world(events, service);
+        EntityManagerView<Pizza, TomatoSauce> allSauces(world);
+        EntityManagerView<Pizza, TomatoSauce, Without<Champignon>> saucesWithoutChampignons(world);
+        // Most pizzas are skipped, as most entities of a system would be when frozen.
+        for (size_t i = 0; i < NumberOfPizzas; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            PAX_MAYBEUNUSED bool added = pizza->add(pax_new(TomatoSauce)(int(i)));
+            if (i % 4 != 0) {
+                added = pizza->add(pax_new(Champignon)());
+            }
+            world.add(pizza);
+        }
+
+        int scovilleByHand = 0;
+        const double nsByHand = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&allSauces, &scovilleByHand]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                allSauces.each([&scovilleByHand](Pizza & pizza, TomatoSauce & sauce) {
+                    if (!pizza.has<Champignon>()) {
+                        scovilleByHand += sauce.getScoville();
+                    }
+                });
+            }
+        });
+
+        int scovilleByView = 0;
+        const double nsByView = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&saucesWithoutChampignons, &scovilleByView]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                saucesWithoutChampignons.each([&scovilleByView](Pizza &, TomatoSauce & sauce) {
+                    scovilleByView += sauce.getScoville();
+                });
+            }
+        });
+
+        Benchmark::report("EntityManagerView filtered with Entity::has", nsByHand, "ns/entity");
+        Benchmark::report("EntityManagerView with Without term", nsByView, "ns/entity");
+        std::cout << std::endl;
+
+        EXPECT_EQ(scovilleByHand, scovilleByView);
+        EXPECT_EQ(saucesWithoutChampignons.size(), NumberOfPizzas / 4);
+        EXPECT_LT(nsByView, nsByHand) << "Excluding entities in the view is slower than filtering them by hand.";
+        PAX_MAYBEUNUSED bool destroyed = world.destroyWorld();
+    }
+
+    PAX_TEST(Benchmark, SignatureChecksAreFasterThanMapLookups)
+        using namespace Examples;
+        constexpr size_t NumberOfPizzas = 10000;
+        constexpr size_t Rounds = 10;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        std::vector<Pizza*> pizzas;
+        for (size_t i = 0; i < NumberOfPizzas; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            PAX_MAYBEUNUSED bool added = pizza->add(pax_new(TomatoSauce)(int(i))) && pizza->add(pax_new(Mozzarella)());
+            if (i % 2 == 0) {
+                added = pizza->add(pax_new(Champignon)());
+            }
+            pizzas.push_back(pizza);
+        }
+
+        size_t matchesByLookup = 0;
+        const double nsPerLookup = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&pizzas, &matchesByLookup]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                for (Pizza * pizza : pizzas) {
+                    matchesByLookup += pizza->has(paxtypeid(TomatoSauce), false)
+                            && pizza->has(paxtypeid(Cheese), true)
+                            && pizza->has(paxtypeid(Champignon), false);
+                }
+            }
+        });
+
+        size_t matchesBySignature = 0;
+        const double nsPerSignature = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&pizzas, &matchesBySignature]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                for (Pizza * pizza : pizzas) {
+                    matchesBySignature += pizza->has<TomatoSauce, Cheese, Champignon>();
+                }
+            }
+        });
+
+        Benchmark::report("Entity::has(TypeId) for three types", nsPerLookup, "ns/entity");
+        Benchmark::report("Entity::has<A, B, C>()", nsPerSignature, "ns/entity");
+        std::cout << std::endl;
+
+        EXPECT_EQ(matchesByLookup, matchesBySignature);
+        EXPECT_LT(nsPerSignature, nsPerLookup) << "Checking property signatures is slower than looking up properties.";
+        for (Pizza * pizza : pizzas) {
+            PAX_MAYBEUNUSED bool deleted = pax_delete(pizza);
+        }
+    }
+    PAX_TEST(Benchmark, TypeIndexLookupsAreFasterThanTypeMapLookups)
+        using namespace Examples;
+        constexpr size_t Lookups = 1000000;
+        TypeMap<size_t> byTypeId;
+        std::vector<size_t> byTypeIndex(TypeIndexRegistry::GetNumberOfTypes() + 8, 0);
+        const auto insert = [&byTypeId, &byTypeIndex](const TypeId & type, TypeIndex index, size_t value) {
+            byTypeId[type] = value;
+            if (index >= byTypeIndex.size()) {
+                byTypeIndex.resize(index + 1, 0);
+            }
+            byTypeIndex[index] = value;
+        };
+        insert(paxtypeid(Pizza), paxtypeindex(Pizza), 1);
+        insert(paxtypeid(Topping), paxtypeindex(Topping), 2);
+        insert(paxtypeid(TomatoSauce), paxtypeindex(TomatoSauce), 3);
+        insert(paxtypeid(Cheese), paxtypeindex(Cheese), 4);
+        insert(paxtypeid(Mozzarella), paxtypeindex(Mozzarella), 5);
+        insert(paxtypeid(Champignon), paxtypeindex(Champignon), 6);
+
+        size_t sumByTypeId = 0;
+        const double nsByTypeId = Benchmark::nanosecondsPer(Lookups, [&byTypeId, &sumByTypeId]() {
+            for (size_t i = 0; i < Lookups; ++i) {
+                sumByTypeId += byTypeId.find(i % 2 ? paxtypeid(Mozzarella) : paxtypeid(Champignon))->second;
+            }
+        });
+
+        size_t sumByTypeIndex = 0;
+        const double nsByTypeIndex = Benchmark::nanosecondsPer(Lookups, [&byTypeIndex, &sumByTypeIndex]() {
+            for (size_t i = 0; i < Lookups; ++i) {
+                sumByTypeIndex += byTypeIndex[i % 2 ? paxtypeindex(Mozzarella) : paxtypeindex(Champignon)];
+            }
+        });
+
+        Benchmark::report("TypeMap lookup by TypeId", nsByTypeId, "ns/lookup");
+        Benchmark::report("Array lookup by TypeIndex", nsByTypeIndex, "ns/lookup");
+        std::cout << std::endl;
+
+        EXPECT_EQ(sumByTypeId, sumByTypeIndex);
+        EXPECT_LT(nsByTypeIndex, nsByTypeId) << "Looking up values by TypeIndex is slower than by TypeId.";
+    }
+    PAX_TEST(Benchmark, FlatTypeMapIsFasterAndSmallerThanStdMap)
+        using namespace Examples;
+        using SingleValue = std::pair<const TypeId, Property<Pizza>*>;
+        using MultipleValue = std::pair<const TypeId, std::vector<Property<Pizza>*>>;
+        using StdSingles = std::map<TypeId, Property<Pizza>*, std::less<TypeId>, Benchmark::CountingAllocator<SingleValue>>;
+        using StdMultiples = std::map<TypeId, std::vector<Property<Pizza>*>, std::less<TypeId>, Benchmark::CountingAllocator<MultipleValue>>;
+        using FlatSingles = FlatTypeMap<Property<Pizza>*, Benchmark::CountingAllocator<std::pair<TypeId, Property<Pizza>*>>>;
+        using FlatMultiples = FlatTypeMap<std::vector<Property<Pizza>*>, Benchmark::CountingAllocator<std::pair<TypeId, std::vector<Property<Pizza>*>>>>;
+        constexpr size_t NumberOfPizzas = 1000;
+        constexpr size_t Rounds = 100;
+
+        // Mirror the maps of a pizza with tomato sauce, mozzarella and champignons.
+        const auto fill = [](auto & singles, auto & multiples) {
+            singles[paxtypeid(TomatoSauce)] = nullptr;
+            singles[paxtypeid(Cheese)] = nullptr;
+            singles[paxtypeid(Mozzarella)] = nullptr;
+            multiples[paxtypeid(Topping)].resize(3);
+            multiples[paxtypeid(Champignon)].resize(1);
+        };
+
+        size_t & bytes = Benchmark::CountingAllocator<char>::bytes();
+        const size_t bytesBefore = bytes;
+        std::vector<StdSingles> stdSingles(NumberOfPizzas);
+        std::vector<StdMultiples> stdMultiples(NumberOfPizzas);
+        for (size_t i = 0; i < NumberOfPizzas; ++i) {
+            fill(stdSingles[i], stdMultiples[i]);
+        }
+        const double stdBytes = double(bytes - bytesBefore) / NumberOfPizzas + sizeof(StdSingles) + sizeof(StdMultiples);
+
+        const size_t bytesBetween = bytes;
+        std::vector<FlatSingles> flatSingles(NumberOfPizzas);
+        std::vector<FlatMultiples> flatMultiples(NumberOfPizzas);
+        for (size_t i = 0; i < NumberOfPizzas; ++i) {
+            fill(flatSingles[i], flatMultiples[i]);
+        }
+        const double flatBytes = double(bytes - bytesBetween) / NumberOfPizzas + sizeof(FlatSingles) + sizeof(FlatMultiples);
+
+        const auto lookup = [](const auto & maps) {
+            size_t found = 0;
+            for (size_t round = 0; round < Rounds; ++round) {
+                for (const auto & map : maps) {
+                    found += map.find(paxtypeid(Mozzarella)) != map.end();
+                }
+            }
+            return found;
+        };
+        size_t foundInStd = 0, foundInFlat = 0;
+        const double nsPerStdLookup = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&]() { foundInStd = lookup(stdSingles); });
+        const double nsPerFlatLookup = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&]() { foundInFlat = lookup(flatSingles); });
+
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        std::vector<Pizza*> pizzas;
+        for (size_t i = 0; i < NumberOfPizzas; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            PAX_MAYBEUNUSED bool added = pizza->add(pax_new(TomatoSauce)(int(i)))
+                    && pizza->add(pax_new(Mozzarella)())
+                    && pizza->add(pax_new(Champignon)());
+            pizzas.push_back(pizza);
+        }
+        size_t scoville = 0;
+        const double nsPerGet = Benchmark::nanosecondsPer(Rounds * NumberOfPizzas, [&pizzas, &scoville]() {
+            for (size_t round = 0; round < Rounds; ++round) {
+                for (Pizza * pizza : pizzas) {
+                    scoville += pizza->get<Mozzarella>() != nullptr;
+                }
+            }
+        });
+
+        Benchmark::report("std::map lookup in property map", nsPerStdLookup, "ns/lookup");
+        Benchmark::report("FlatTypeMap lookup in property map", nsPerFlatLookup, "ns/lookup");
+#ifdef PAX_WITH_FLAT_TYPE_MAP
+        Benchmark::report("Entity::get<T>() with FlatTypeMap", nsPerGet, "ns/lookup");
+#else
+        Benchmark::report("Entity::get<T>() with std::map", nsPerGet, "ns/lookup");
+#endif
+        Benchmark::report("Property maps of an entity with std::map", stdBytes, "bytes");
+        Benchmark::report("Property maps of an entity with FlatTypeMap", flatBytes, "bytes");
+        std::cout << std::endl;
+
+        EXPECT_EQ(foundInStd, foundInFlat);
+        EXPECT_EQ(scoville, Rounds * NumberOfPizzas);
+        EXPECT_LT(flatBytes, stdBytes) << "FlatTypeMaps take more memory than std::maps.";
+        EXPECT_LT(nsPerFlatLookup, nsPerStdLookup * 2) << "Looking up types in FlatTypeMaps is much slower than in std::maps.";
+        for (Pizza * pizza : pizzas) {
+            PAX_MAYBEUNUSED bool deleted = pax_delete(pizza);
+        }
+    }
+    PAX_TEST(Benchmark, LazyLocalEventServicesShrinkEntities)
+        using namespace Examples;
+        struct Listener {
+            void onBaked(BakedEvent &) {}
+        } listener;
+
+        constexpr size_t NumberOfPizzas = 1000;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        std::vector<Pizza*> pizzas(NumberOfPizzas);
+
+        // Create and delete all pizzas once, such that the pool already holds its pages when we measure.
+        for (Pizza *& pizza : pizzas) {
+            pizza = pax_new(Pizza)();
+        }
+        for (Pizza * pizza : pizzas) {
+            PAX_MAYBEUNUSED bool deleted = pax_delete(pizza);
+        }
+
+        const size_t heapBefore = Benchmark::heapBytes();
+        for (Pizza *& pizza : pizzas) {
+            pizza = pax_new(Pizza)();
+        }
+        const size_t heapWithoutListeners = Benchmark::heapBytes();
+        for (Pizza * pizza : pizzas) {
+            pizza->getEventService().add<BakedEvent, Listener, &Listener::onBaked>(&listener);
+        }
+        const size_t heapWithListeners = Benchmark::heapBytes();
+        for (Pizza * pizza : pizzas) {
+            PAX_MAYBEUNUSED bool deleted = pax_delete(pizza);
+        }
+        const size_t heapAfter = Benchmark::heapBytes();
+
+        const size_t poolBytesPerEntity = service.getAllocator(paxtypeid(Pizza))->getAllocationSize();
+        const double heapBytesPerEntity = double(heapWithoutListeners - heapBefore) / double(NumberOfPizzas);
+        const double listenerHeapBytesPerEntity = double(heapWithListeners - heapWithoutListeners) / double(NumberOfPizzas);
+        // Before, each entity embedded a whole EventService instead of a LocalEventService.
+        const size_t poolBytesPerEntityBefore = poolBytesPerEntity - sizeof(LocalEventService) + sizeof(EventService);
+
+        Benchmark::report("Pool bytes per Pizza with embedded EventService", double(poolBytesPerEntityBefore), "bytes");
+        Benchmark::report("Pool bytes per Pizza with LocalEventService", double(poolBytesPerEntity), "bytes");
+        Benchmark::report("Heap bytes per Pizza without local listeners", heapBytesPerEntity, "bytes");
+        Benchmark::report("Extra heap bytes per Pizza with a local listener", listenerHeapBytesPerEntity, "bytes");
+        std::cout << std::endl;
+
+        // Deleting the pizzas has to release everything we counted.
+        EXPECT_EQ(heapAfter, heapBefore);
+        EXPECT_LT(poolBytesPerEntity, poolBytesPerEntityBefore);
+        // Entities without local listeners must not allocate an EventService.
+        EXPECT_LT(heapBytesPerEntity, double(sizeof(EventService)));
+        // The service, its listener list, and the delegate vector are allocated lazily for the first listener.
+        EXPECT_GE(listenerHeapBytesPerEntity, double(sizeof(EventService)));
+    }
+}
+
+#endif //POLYPROPYLENE_BENCHMARKS_H
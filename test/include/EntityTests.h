@@ -5,9 +5,16 @@
 #ifndef POLYPROPYLENE_ENTITYTESTS_H
 #define POLYPROPYLENE_ENTITYTESTS_H
 
+#include <algorithm>
+
 #include "PaxTest.h"
 
 #include "Pizza.h"
+#include "toppings/TomatoSauce.h"
+#include "BakedEvent.h"
+#include "polypropylene/memory/PropertyPool.h"
+#include "polypropylene/property/EntityManagerView.h"
+#include "polypropylene/reflection/TypeIndex.h"
 
 namespace PAX {
     PAX_TEST(Entity, GettingAllProperties)
@@ -56,6 +63,456 @@ namespace PAX {
 
         EXPECT_TRUE(pax_delete(pizza));
     }
+
+    PAX_TEST(Entity, WorldsAllocateFromTheirOwnServicesAndTearDownIndependently)
+        using namespace Examples;
+        EventService eventsA, eventsB;
+        AllocationService servicesA, servicesB;
+        EntityManager<Pizza> worldA(eventsA, servicesA);
+        EntityManager<Pizza> worldB(eventsB, servicesB);
+
+        const auto populate = [](EntityManager<Pizza> & world, int numberOfPizzas) {
+            AllocationServiceScope<Pizza> scope(world.getAllocationService());
+            for (int i = 0; i < numberOfPizzas; ++i) {
+                Pizza * pizza = pax_new(Pizza)();
+                EXPECT_TRUE(pizza->add(pax_new(TomatoSauce)(i)));
+                EXPECT_EQ(&pizza->getAllocationService(), &world.getAllocationService());
+                world.add(pizza);
+            }
+        };
+        populate(worldA, 1);
+        populate(worldB, 2);
+
+        Pizza * pizzaA = *worldA.begin();
+        EXPECT_TRUE(servicesA.hasAllocated(paxtypeid(Pizza), pizzaA));
+        EXPECT_FALSE(servicesB.hasAllocated(paxtypeid(Pizza), pizzaA));
+        EXPECT_FALSE(Pizza::GetDefaultAllocationService().hasAllocated(paxtypeid(Pizza), pizzaA));
+
+        size_t saucesInB = 0;
+        for (PAX_MAYBEUNUSED TomatoSauce * sauce : PropertyPool<TomatoSauce>(servicesB)) {
+            ++saucesInB;
+        }
+        EXPECT_EQ(saucesInB, 2);
+
+        // Entities are deleted with the service they were allocated with, regardless of the binding.
+        Pizza * stray = nullptr;
+        {
+            AllocationServiceScope<Pizza> scope(servicesA);
+            stray = pax_new(Pizza)();
+        }
+        Handle<Pizza> strayHandle = pax_handle(stray);
+        EXPECT_TRUE(strayHandle.isValid());
+        EXPECT_TRUE(pax_delete(stray));
+        EXPECT_FALSE(strayHandle.isValid());
+        EXPECT_EQ(servicesA.getStatistics().at(paxtypeid(Pizza)).liveObjects, 1);
+
+        // The same holds for properties that were removed from their entity.
+        Pizza * pizzaB = *worldB.begin();
+        TomatoSauce * sauceB = pizzaB->get<TomatoSauce>();
+        EXPECT_EQ(&sauceB->getAllocationService(), &servicesB);
+        EXPECT_TRUE(pizzaB->remove(sauceB));
+        EXPECT_TRUE(pax_delete(sauceB));
+        EXPECT_EQ(servicesB.getStatistics().at(paxtypeid(TomatoSauce)).liveObjects, 1);
+        {
+            AllocationServiceScope<Pizza> scope(servicesB);
+            EXPECT_TRUE(pizzaB->add(pax_new(TomatoSauce)(3)));
+        }
+        EXPECT_EQ(&pizzaB->get<TomatoSauce>()->getAllocationService(), &servicesB);
+
+        // Tearing down a world does not depend on the service bound at that time.
+        {
+            AllocationServiceScope<Pizza> scope(servicesB);
+            worldA.clear();
+            EXPECT_EQ(&Pizza::GetAllocationService(), &servicesB);
+        }
+        EXPECT_EQ(&Pizza::GetAllocationService(), &Pizza::GetDefaultAllocationService());
+        EXPECT_EQ(servicesA.getStatistics().at(paxtypeid(Pizza)).liveObjects, 0);
+        EXPECT_EQ(servicesA.getStatistics().at(paxtypeid(TomatoSauce)).liveObjects, 0);
+        EXPECT_EQ(servicesB.getStatistics().at(paxtypeid(TomatoSauce)).liveObjects, 2);
+
+        worldB.clear();
+        EXPECT_EQ(servicesB.getStatistics().at(paxtypeid(TomatoSauce)).liveObjects, 0);
+    }
+
+    PAX_TEST(Entity, DestroyingWorldSendsSingleEventAndFreesAllPools)
+        using namespace Examples;
+        struct Listener {
+            size_t removed = 0;
+            size_t cleared = 0;
+            void onRemoved(EntityRemovedEvent<Pizza> &) { ++removed; }
+            void onCleared(WorldClearedEvent<Pizza> & e) { cleared += e.numberOfEntities; }
+        } listener;
+
+        EventService events;
+        events.add<EntityRemovedEvent<Pizza>, Listener, &Listener::onRemoved>(&listener);
+        events.add<WorldClearedEvent<Pizza>, Listener, &Listener::onCleared>(&listener);
+
+        AllocationService service;
+        EntityManager<Pizza> world(events, service);
+        Handle<TomatoSauce> sauce;
+        {
+            AllocationServiceScope<Pizza> scope(service);
+            for (int i = 0; i < 100; ++i) {
+                Pizza * pizza = pax_new(Pizza)();
+                TomatoSauce * s = pax_new(TomatoSauce)(i);
+                EXPECT_TRUE(pizza->add(s));
+                world.add(pizza);
+                sauce = pax_handle(s);
+            }
+        }
+
+        EXPECT_TRUE(world.destroyWorld());
+        EXPECT_TRUE(world.empty());
+        EXPECT_EQ(listener.removed, 0);
+        EXPECT_EQ(listener.cleared, 100);
+        EXPECT_FALSE(sauce);
+        EXPECT_EQ(service.getStatistics().at(paxtypeid(Pizza)).liveObjects, 0);
+        EXPECT_EQ(service.getStatistics().at(paxtypeid(TomatoSauce)).liveObjects, 0);
+    }
+
+    PAX_TEST(Entity, ViewsForgetDestroyedWorlds)
+        using namespace Examples;
+        EventService events;
+        AllocationService service;
+        EntityManager<Pizza> world(events, service);
+        EntityManagerView<Pizza, TomatoSauce> view(world);
+
+        const auto populate = [&world, &service](int numberOfPizzas) {
+            AllocationServiceScope<Pizza> scope(service);
+            for (int i = 0; i < numberOfPizzas; ++i) {
+                Pizza * pizza = pax_new(Pizza)();
+                EXPECT_TRUE(pizza->add(pax_new(TomatoSauce)(i)));
+                world.add(pizza);
+            }
+        };
+
+        populate(3);
+        EXPECT_EQ(view.size(), 3);
+        EXPECT_TRUE(world.destroyWorld());
+        EXPECT_EQ(view.size(), 0);
+        EXPECT_TRUE(view.getProperties().empty());
+        view.each([](Pizza &, TomatoSauce &) { FAIL(); });
+
+        // Entities of the next generation of the world may reuse the memory of destroyed ones.
+        populate(2);
+        EXPECT_EQ(view.size(), 2);
+        size_t visited = 0;
+        view.each([&visited](Pizza & p, TomatoSauce & sauce) {
+            EXPECT_EQ(&sauce, p.get<TomatoSauce>());
+            ++visited;
+        });
+        EXPECT_EQ(visited, 2);
+
+        EXPECT_TRUE(world.destroyWorld());
+        EXPECT_EQ(view.size(), 0);
+    }
+
+    PAX_TEST(Entity, ViewsFollowPropertiesAndSwapRemovedEntities)
+        using namespace Examples;
+        EventService events;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        EntityManager<Pizza> world(events, service);
+        EntityManagerView<Pizza, Champignon, TomatoSauce> view(world);
+
+        std::vector<Pizza*> pizzas;
+        for (int i = 0; i < 10; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            EXPECT_TRUE(pizza->add(pax_new(Champignon)()));
+            if (i % 2 == 0) {
+                EXPECT_TRUE(pizza->add(pax_new(TomatoSauce)(i)));
+            }
+            world.add(pizza);
+            pizzas.push_back(pizza);
+        }
+        EXPECT_EQ(view.size(), 5);
+
+        // Removing the first entity of the view moves the last one into its place.
+        TomatoSauce * sauce = pizzas[0]->get<TomatoSauce>();
+        EXPECT_TRUE(pizzas[0]->remove(sauce));
+        EXPECT_TRUE(pax_delete(sauce));
+        EXPECT_FALSE(view.contains(pizzas[0]));
+        EXPECT_EQ(view.size(), 4);
+        EXPECT_EQ(view.getEntities().front(), pizzas[8]);
+
+        EXPECT_TRUE(pizzas[1]->add(pax_new(TomatoSauce)(1)));
+        EXPECT_TRUE(world.remove(pizzas[4]));
+        EXPECT_TRUE(pax_delete(pizzas[4]));
+        EXPECT_EQ(view.size(), 4);
+        for (Pizza * pizza : view) {
+            EXPECT_TRUE(view.contains(pizza));
+            EXPECT_TRUE((pizza->has<Champignon, TomatoSauce>()));
+        }
+
+        view.sortByAddress();
+        EXPECT_TRUE(std::is_sorted(view.begin(), view.end()));
+        EXPECT_TRUE(view.contains(pizzas[1]));
+
+        EXPECT_TRUE(world.destroyWorld());
+        EXPECT_EQ(view.size(), 0);
+        EXPECT_FALSE(view.contains(pizzas[1]));
+    }
+
+    PAX_TEST(Entity, ViewsPassCachedPropertiesToEach)
+        using namespace Examples;
+        EventService events;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        EntityManager<Pizza> world(events, service);
+        EntityManagerView<Pizza, TomatoSauce, Topping> view(world);
+
+        for (int i = 0; i < 10; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            EXPECT_TRUE(pizza->add(pax_new(TomatoSauce)(i)));
+            EXPECT_TRUE(pizza->add(pax_new(Champignon)()));
+            world.add(pizza);
+        }
+
+        // Removing one of multiple toppings keeps the entity in the view.
+        Pizza * pizza = view.getEntities().front();
+        Champignon * champignon = pizza->get<Champignon>();
+        EXPECT_TRUE(pizza->remove(champignon));
+        EXPECT_TRUE(pax_delete(champignon));
+        EXPECT_EQ(view.size(), 10);
+
+        size_t visited = 0;
+        view.each([&visited, pizza](Pizza & p, TomatoSauce & sauce, const std::vector<Topping*> & toppings) {
+            EXPECT_EQ(&sauce, p.get<TomatoSauce>());
+            EXPECT_EQ(&toppings, &p.getMultiple(paxtypeid(Topping)));
+            EXPECT_EQ(toppings.size(), &p == pizza ? 1 : 2);
+            ++visited;
+        });
+        EXPECT_EQ(visited, view.size());
+        EXPECT_EQ(std::get<1>(view.getProperties().front())->get<Topping>().front(), pizza->get<TomatoSauce>());
+
+        view.sortByAddress();
+        for (size_t i = 0; i < view.size(); ++i) {
+            EXPECT_EQ(std::get<0>(view.getProperties()[i]), view.getEntities()[i]->get<TomatoSauce>());
+        }
+
+        EXPECT_TRUE(world.destroyWorld());
+    }
+
+    PAX_TEST(Entity, ViewsFollowCompactedPools)
+        using namespace Examples;
+        struct CheeseListener {
+            size_t relocations = 0;
+            void onRelocated(PropertyRelocatedEvent<Pizza, Cheese> &) { ++relocations; }
+        } cheeseListener;
+
+        EventService events;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        EntityManager<Pizza> world(events, service);
+        PropertyPool<TomatoSauce> sauces(service);
+        PropertyPool<Mozzarella> mozzarellas(service);
+        EntityManagerView<Pizza, TomatoSauce, Optional<Mozzarella>> view(world);
+        events.add<PropertyRelocatedEvent<Pizza, Cheese>, CheeseListener, &CheeseListener::onRelocated>(&cheeseListener);
+
+        std::vector<Pizza*> pizzas;
+        for (int i = 0; i < 10; ++i) {
+            Pizza * pizza = pax_new(Pizza)();
+            EXPECT_TRUE(pizza->add(pax_new(TomatoSauce)(i)));
+            EXPECT_TRUE(pizza->add(pax_new(Mozzarella)()));
+            world.add(pizza);
+            pizzas.push_back(pizza);
+        }
+
+        // Leave holes at the front of the pools.
+        for (int i = 0; i < 5; ++i) {
+            EXPECT_TRUE(world.remove(pizzas.at(i)));
+            EXPECT_TRUE(pax_delete(pizzas.at(i)));
+        }
+        EXPECT_EQ(view.size(), 5);
+
+        EXPECT_GT(sauces.compact(), 0);
+        const size_t movedMozzarellas = mozzarellas.compact();
+        EXPECT_GT(movedMozzarellas, 0);
+        // Relocations are also sent for the super types of the moved property.
+        EXPECT_EQ(cheeseListener.relocations, movedMozzarellas);
+
+        size_t visited = 0;
+        view.each([&visited](Pizza & p, TomatoSauce & sauce, Mozzarella * m) {
+            EXPECT_EQ(&sauce, p.get<TomatoSauce>());
+            EXPECT_EQ(m, p.get<Mozzarella>());
+            EXPECT_EQ(sauce.getOwner(), &p);
+            ++visited;
+        });
+        EXPECT_EQ(visited, 5);
+
+        events.remove<PropertyRelocatedEvent<Pizza, Cheese>, CheeseListener, &CheeseListener::onRelocated>(&cheeseListener);
+        EXPECT_TRUE(world.destroyWorld());
+    }
+
+    PAX_TEST(Entity, ViewsExcludeAndOptionallyCacheProperties)
+        using namespace Examples;
+        EventService events;
+        AllocationService service;
+        AllocationServiceScope<Pizza> scope(service);
+        EntityManager<Pizza> world(events, service);
+        EntityManagerView<Pizza, TomatoSauce, Without<Champignon>, Optional<Mozzarella, Cheese>> view(world);
+
+        Pizza * margherita = pax_new(Pizza)();
+        EXPECT_TRUE(margherita->add(pax_new(TomatoSauce)(1)));
+        Pizza * funghi = pax_new(Pizza)();
+        EXPECT_TRUE(funghi->add(pax_new(TomatoSauce)(2)));
+        Champignon * champignon = pax_new(Champignon)();
+        EXPECT_TRUE(funghi->add(champignon));
+        world.add(margherita);
+        world.add(funghi);
+
+        EXPECT_TRUE(view.contains(margherita));
+        EXPECT_FALSE(view.contains(funghi));
+
+        // Detaching an excluded property lets the entity in.
+        EXPECT_TRUE(funghi->remove(champignon));
+        EXPECT_TRUE(view.contains(funghi));
+        // ... and attaching it again kicks it out.
+        EXPECT_TRUE(funghi->add(champignon));
+        EXPECT_FALSE(view.contains(funghi));
+
+        // Optional properties are resolved when they are attached or detached.
+        Mozzarella * mozzarella = pax_new(Mozzarella)();
+        EXPECT_TRUE(margherita->add(mozzarella));
+        size_t visited = 0;
+        view.each([&](Pizza & pizza, TomatoSauce & sauce, Mozzarella * m, const std::vector<Topping*> & cheeses) {
+            EXPECT_EQ(&pizza, margherita);
+            EXPECT_EQ(sauce.getScoville(), 1);
+            EXPECT_EQ(m, mozzarella);
+            EXPECT_EQ(cheeses.size(), 1);
+            EXPECT_EQ(static_cast<Cheese*>(cheeses.front()), mozzarella);
+            ++visited;
+        });
+        EXPECT_EQ(visited, 1);
+
+        EXPECT_TRUE(margherita->remove(mozzarella));
+        EXPECT_TRUE(pax_delete(mozzarella));
+        view.each([](Pizza &, TomatoSauce &, Mozzarella * m, const std::vector<Topping*> & cheeses) {
+            EXPECT_EQ(m, nullptr);
+            EXPECT_TRUE(cheeses.empty());
+        });
+
+        EXPECT_TRUE(world.destroyWorld());
+    }
+
+    PAX_TEST(Entity, PropertySignatureMirrorsContainedProperties)
+        using namespace Examples;
+        Pizza * pizza = pax_new(Pizza)();
+        EXPECT_TRUE(pizza->getPropertySignature() == PropertySignature());
+
+        TomatoSauce * sauce = pax_new(TomatoSauce)(3);
+        Mozzarella * mozzarella = pax_new(Mozzarella)();
+        EXPECT_TRUE(pizza->add(sauce));
+        EXPECT_TRUE(pizza->add(mozzarella));
+        // Adding a property adds all of its super types.
+        EXPECT_TRUE((pizza->getPropertySignature().containsAll(PropertySignature::Of<Topping, TomatoSauce, Cheese, Mozzarella>())));
+        EXPECT_TRUE((pizza->has<TomatoSauce, Cheese, Mozzarella>()));
+        EXPECT_FALSE((pizza->has<TomatoSauce, Champignon>()));
+
+        // Types of multiple multiplicity stay until their last property is removed.
+        Champignon * champignon = pax_new(Champignon)();
+        EXPECT_TRUE(pizza->add(champignon));
+        EXPECT_TRUE(pizza->remove(champignon));
+        EXPECT_TRUE(pax_delete(champignon));
+        EXPECT_TRUE((pizza->has<Topping, Cheese>()));
+        EXPECT_FALSE(pizza->has<Champignon>());
+
+        EXPECT_TRUE(pizza->remove(mozzarella));
+        EXPECT_TRUE(pax_delete(mozzarella));
+        EXPECT_FALSE(pizza->has<Cheese>());
+        EXPECT_TRUE((pizza->getPropertySignature() == PropertySignature::Of<Topping, TomatoSauce>()));
+        EXPECT_EQ(pizza->has<TomatoSauce>(), pizza->has(paxtypeid(TomatoSauce)));
+
+        EXPECT_TRUE(pax_delete(pizza));
+    }
+
+    PAX_TEST(Entity, TypeIndicesAreDenseAndKeyEventListeners)
+        using namespace Examples;
+        const TypeIndex pizza = paxtypeindex(Pizza);
+        const TypeIndex sauce = paxtypeindex(TomatoSauce);
+        EXPECT_NE(pizza, sauce);
+        EXPECT_EQ(pizza, paxtypeindex(Pizza));
+        EXPECT_LT(pizza, TypeIndexRegistry::GetNumberOfTypes());
+        EXPECT_LT(sauce, TypeIndexRegistry::GetNumberOfTypes());
+        EXPECT_EQ(TypeIndexRegistry::Find(paxtypeid(Pizza)), pizza);
+        EXPECT_TRUE(TypeIndexRegistry::GetTypeId(sauce) == paxtypeid(TomatoSauce));
+
+        // Indices are handed out sequentially, so a new type gets the next free one.
+        struct NeverUsedBefore {};
+        EXPECT_EQ(TypeIndexRegistry::Find(paxtypeid(NeverUsedBefore)), TypeIndexRegistry::InvalidIndex);
+        const size_t numberOfTypes = TypeIndexRegistry::GetNumberOfTypes();
+        EXPECT_EQ(paxtypeindex(NeverUsedBefore), numberOfTypes);
+        EXPECT_EQ(TypeIndexRegistry::GetNumberOfTypes(), numberOfTypes + 1);
+
+        // Each kind counts separately, so property indices stay small and agree with the registry.
+        struct NeverUsedProperty {};
+        const size_t propertyIndex = PropertySignature::IndexOf<NeverUsedProperty>();
+        EXPECT_EQ(propertyIndex, (TypeIndexRegistry::OfKind<PropertySignature, NeverUsedProperty>()));
+        EXPECT_EQ(TypeIndexRegistry::Find(paxtypeid(NeverUsedProperty)), TypeIndexRegistry::InvalidIndex);
+        EXPECT_NE(PropertySignature::IndexOf<TomatoSauce>(), propertyIndex);
+
+        struct Listener {
+            size_t baked = 0;
+            size_t removed = 0;
+            void onBaked(BakedEvent &) { ++baked; }
+            void onRemoved(EntityRemovedEvent<Pizza> &) { ++removed; }
+        } listener;
+
+        EventService events;
+        events.add<EntityRemovedEvent<Pizza>, Listener, &Listener::onRemoved>(&listener);
+        events.add<BakedEvent, Listener, &Listener::onBaked>(&listener);
+        BakedEvent baked;
+        events(baked);
+        events(baked);
+        EXPECT_EQ(listener.baked, 2);
+        EXPECT_EQ(listener.removed, 0);
+
+        EXPECT_TRUE((events.remove<BakedEvent, Listener, &Listener::onBaked>(&listener)));
+        EXPECT_FALSE((events.remove<BakedEvent, Listener, &Listener::onBaked>(&listener)));
+        events(baked);
+        EXPECT_EQ(listener.baked, 2);
+    }
+    PAX_TEST(Entity, LocalEventServiceIsAllocatedOnFirstListener)
+        using namespace Examples;
+        struct Listener {
+            size_t baked = 0;
+            void onBaked(BakedEvent &) { ++baked; }
+        } local, global;
+
+        EventService events;
+        events.add<BakedEvent, Listener, &Listener::onBaked>(&global);
+        AllocationService service;
+        EntityManager<Pizza> world(events, service);
+        AllocationServiceScope<Pizza> scope(service);
+        Pizza * pizza = pax_new(Pizza)();
+        world.add(pizza);
+        EXPECT_TRUE(pizza->add(pax_new(TomatoSauce)(1)));
+        EXPECT_EQ(pizza->getEventService().get(), nullptr);
+
+        // Without local listeners, events go straight to the service of the manager.
+        BakedEvent baked;
+        pizza->getEventService().fire(baked);
+        EXPECT_EQ(global.baked, 1);
+        EXPECT_EQ(pizza->getEventService().get(), nullptr);
+        EXPECT_FALSE((pizza->getEventService().remove<BakedEvent, Listener, &Listener::onBaked>(&local)));
+
+        pizza->getEventService().add<BakedEvent, Listener, &Listener::onBaked>(&local);
+        ASSERT_NE(pizza->getEventService().get(), nullptr);
+        EXPECT_EQ(pizza->getEventService().get()->getParent(), &events);
+        pizza->getEventService().fire(baked);
+        EXPECT_EQ(local.baked, 1);
+        EXPECT_EQ(global.baked, 2);
+
+        EXPECT_TRUE((pizza->getEventService().remove<BakedEvent, Listener, &Listener::onBaked>(&local)));
+        pizza->getEventService().fire(baked);
+        EXPECT_EQ(local.baked, 1);
+        EXPECT_EQ(global.baked, 3);
+
+        world.remove(pizza);
+        EXPECT_EQ(pizza->getEventService().getParent(), nullptr);
+        EXPECT_EQ(pizza->getEventService().get()->getParent(), nullptr);
+        EXPECT_TRUE(pax_delete(pizza));
+    }
 }
 
 #endif //POLYPROPYLENE_ENTITYTESTS_H
@@ -0,0 +1,62 @@
+//
+// Created by Paul Bittner on 17.10.2026.
+//
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "toppings/Mozzarella.h"
+#include "toppings/Champignon.h"
+
+/// This include may be reported as unused but it is necessary!
+/// If we do not include our benchmarks here, RUN_ALL_TESTS won't find them.
+#include "Benchmarks.h"
+
+namespace {
+    std::atomic<size_t> allocatedBytes { 0 };
+
+    /// Each allocation is prefixed with its size, such that operator delete knows how many bytes are released.
+    constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+    void * allocateCounted(size_t size) {
+        char * memory = static_cast<char*>(std::malloc(HeaderSize + size));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        *reinterpret_cast<size_t*>(memory) = size;
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        return memory + HeaderSize;
+    }
+
+    void freeCounted(void * data) noexcept {
+        if (data) {
+            char * memory = static_cast<char*>(data) - HeaderSize;
+            allocatedBytes.fetch_sub(*reinterpret_cast<size_t*>(memory), std::memory_order_relaxed);
+            std::free(memory);
+        }
+    }
+}
+
+size_t PAX::Benchmark::heapBytes() {
+    return allocatedBytes.load(std::memory_order_relaxed);
+}
+
+void * operator new(size_t size) { return allocateCounted(size); }
+void * operator new[](size_t size) { return allocateCounted(size); }
+void operator delete(void * data) noexcept { freeCounted(data); }
+void operator delete[](void * data) noexcept { freeCounted(data); }
+void operator delete(void * data, size_t) noexcept { freeCounted(data); }
+void operator delete[](void * data, size_t) noexcept { freeCounted(data); }
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    PAX_PROPERTY_REGISTER(PAX::Examples::Mozzarella);
+    PAX_PROPERTY_REGISTER(PAX::Examples::Champignon);
+    PAX_PROPERTY_REGISTER(PAX::Examples::TomatoSauce);
+
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file